@@ -0,0 +1,174 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+analysis-kernels.cpp is a microbenchmark of the steps that analyze the results of a nominal set, for a range of parameters, features and points:
+	load_output (io.cpp): reading the features file of one dimension, with the layout of the files cached as in a run.
+	fin_dif_one_dim (analysis.cpp): the finite differences (fdy_fdx_all() in finite-difference.cpp) of every feature of every dimension.
+	normalize (analysis.cpp): normalizing the sensitivities of every feature.
+	write_sensitivity (io.cpp): writing the sensitivities to a results file.
+Build it with "scons benchmarks" and run ./benchmarks/analysis-kernels [repetitions] [directory]. The times are per nominal set, except load_output's, which is per file.
+*/
+
+#include <time.h>
+
+#include "../source/analysis.hpp"
+#include "../source/io.hpp"
+#include "../source/macros.hpp"
+
+using namespace std;
+
+//The sizes that are benchmarked: every combination of BENCH_DIMS parameters, BENCH_FEATURES features and BENCH_POINTS points.
+static const int bench_dims[] = {10, 100};
+static const int bench_features[] = {10, 150};
+static const int bench_points[] = {1, 2, 4};
+#define BENCH_DIMS 2
+#define BENCH_FEATURES 2
+#define BENCH_POINTS 3
+
+double seconds () {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+//The value of feature k at perturbation c of dimension i, which changes smoothly with the perturbation so the round errors stay small.
+double bench_value (int i, int k, int c) {
+	return 10 + k + 0.001 * (i + 1) * (k + 1) * c;
+}
+
+//Writes a features file of one dimension like the ones the simulation makes, with sets rows of features values.
+void write_features (char* file_name, int features, int sets) {
+	FILE* file_pointer = fopen(file_name, "w");
+	fprintf(file_pointer, "set,");
+	for(int k = 0; k < features; k++){
+		fprintf(file_pointer, "feature %d wildtype,", k);
+	}
+	fprintf(file_pointer, "\n");
+	for(int c = 0; c < sets; c++){
+		fprintf(file_pointer, "%d,", c);
+		for(int k = 0; k < features; k++){
+			fprintf(file_pointer, "%.30g,", bench_value(0, k, c));
+		}
+		fprintf(file_pointer, "PASSED\n");
+	}
+	fclose(file_pointer);
+}
+
+/*	Times every step for dims parameters, features features and points points, repetitions times, and prints one line of the table.
+	Returns false if a file could not be read or written.
+*/
+bool time_steps (int dims, int features, int points, int repetitions, const char* dir) {
+	int sets = 2 * points;
+	char* file_name = (char*)mallocate(strlen(dir) + 64);
+	sprintf(file_name, "%s/analysis-bench-%d", dir, (int)getpid());
+	write_features(file_name, features, sets);
+	
+	output_layout layout;
+	double start = seconds();
+	for(int r = 0; r < repetitions; r++){
+		int num_types = 0;
+		matrix* output = load_output(sets, &num_types, file_name, NULL, &layout, NULL);
+		if(output == NULL || num_types != features){
+			mfree(file_name);
+			return false;
+		}
+		delete output;
+	}
+	double load_time = (seconds() - start) * 1e6 / repetitions;
+	
+	//The results of every dimension, as collect_job() stores them: a features x sets matrix of each.
+	matrix** dim_output = new matrix*[dims];
+	for(int i = 0; i < dims; i++){
+		dim_output[i] = new matrix(features, sets, COL_MAJOR);
+		for(int c = 0; c < sets; c++){
+			for(int k = 0; k < features; k++){
+				dim_output[i]->at(k, c) = bench_value(i, k, c);
+			}
+		}
+	}
+	matrix lsa(dims, features, ROW_MAJOR);
+	matrix round_errors(1, features, ROW_MAJOR);
+	start = seconds();
+	for(int r = 0; r < repetitions; r++){
+		for(int i = 0; i < dims; i++){
+			fin_dif_one_dim(sets, 0.01, *dim_output[i], lsa.row(i), round_errors.row(0));
+		}
+	}
+	double dif_time = (seconds() - start) * 1e6 / repetitions;
+	
+	//Normalizing works in place, so it is timed on a fresh copy of the sensitivities every time, and the copying is timed separately.
+	matrix sense(dims, features, ROW_MAJOR);
+	start = seconds();
+	for(int r = 0; r < repetitions; r++){
+		memcpy(sense.data, lsa.data, sizeof(double) * (size_t)sense.stride * dims);
+	}
+	double copy_time = seconds() - start;
+	start = seconds();
+	for(int r = 0; r < repetitions; r++){
+		memcpy(sense.data, lsa.data, sizeof(double) * (size_t)sense.stride * dims);
+		normalize(sense);
+	}
+	double norm_time = (seconds() - start - copy_time) * 1e6 / repetitions;
+	
+	char** names = new char*[features];
+	for(int k = 0; k < features; k++){
+		names[k] = new char[32];
+		sprintf(names[k], "feature %d wildtype", k);
+	}
+	start = seconds();
+	for(int r = 0; r < repetitions; r++){
+		write_sensitivity(dims, features, names, lsa, file_name);
+	}
+	double write_time = (seconds() - start) * 1e6 / repetitions;
+	
+	cout << dims << "\t\t" << features << "\t\t" << points << "\t\t" << load_time << "\t\t" << dif_time << "\t\t" << norm_time << "\t\t" << write_time << "\n";
+	for(int k = 0; k < features; k++){
+		delete[] names[k];
+	}
+	delete[] names;
+	for(int i = 0; i < dims; i++){
+		delete dim_output[i];
+	}
+	delete[] dim_output;
+	unlink(file_name);
+	mfree(file_name);
+	return true;
+}
+
+int main (int argc, char** argv) {
+	int repetitions = (argc > 1 ? atoi(argv[1]) : 200);
+	const char* dir = (argc > 2 ? argv[2] : "/tmp");
+	if(repetitions < 1){
+		usage("The number of repetitions must be a positive integer.", 1);
+	}
+	cout.precision(4);
+	cout << "Microseconds per call, " << repetitions << " repetitions\n";
+	cout << "params\tfeatures\tpoints\tload_output\tfin_dif\t\tnormalize\twrite\n";
+	for(int d = 0; d < BENCH_DIMS; d++){
+		for(int f = 0; f < BENCH_FEATURES; f++){
+			for(int p = 0; p < BENCH_POINTS; p++){
+				if(!time_steps(bench_dims[d], bench_features[f], bench_points[p], repetitions, dir)){
+					cout << "Could not read or write the files in " << dir << "\n";
+					return 1;
+				}
+			}
+		}
+	}
+	return 0;
+}
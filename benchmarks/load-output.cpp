@@ -0,0 +1,214 @@
+/*	
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+load-output.cpp is a microbenchmark of load_output() (see io.cpp) against the fscanf parser it replaced, on features files of MAX_NUM_FEATS features and 40 sets.
+Build it with "scons benchmarks" and run ./benchmarks/load-output [repetitions] [directory].
+*/
+
+#include <time.h>
+
+#include "../source/io.hpp"
+#include "../source/macros.hpp"
+
+using namespace std;
+
+#define BENCH_FEATURES MAX_NUM_FEATS
+#define BENCH_SETS 40
+#define BENCH_FILES 21 //The nominal file and the files of 20 dimensions.
+
+//The benchmark only reads files, so the functions of analysis.cpp that init.cpp refers to are never called.
+void usage (const char* message, int error) {
+	if(message != NULL) cout << message << "\n";
+	exit(error);
+}
+void licensing () {
+	exit(0);
+}
+
+/*	The load_output() function as it was before it read the files through map_file(), which reads every character and value with fscanf.
+*/
+double** fscanf_load_output (int num_values, int* num_types, char* file_name, char*** output_names) {
+	FILE* file_pointer = fopen(file_name, "r");
+	if(file_pointer == NULL){
+		*num_types = 0;
+		return NULL;
+	}
+	int output_types = 0;
+	bool name_store = (output_names != NULL);
+	if(name_store){
+		(*output_names) = new char*[MAX_NUM_FEATS];
+	}
+	int o_n_index = 0;
+	fscanf(file_pointer, "set,");
+	for(char c = '\0'; c != '\n'; fscanf(file_pointer, "%c", &c)){
+		if( c == ','){
+			output_types ++;
+			if(name_store && output_types < MAX_NUM_FEATS){
+				o_n_index = 0;
+			} else{
+				o_n_index = 50;
+			}
+		} else{
+			if (o_n_index < 48 && name_store && alph_num_slash(c)){
+				if(o_n_index == 0){
+					(*output_names)[output_types] = new char[50];
+				}
+				(*output_names)[output_types][o_n_index] = c;
+				(*output_names)[output_types][o_n_index+1] = '\0';
+				o_n_index ++;
+			}
+		}
+	}
+	output_types = min(output_types, MAX_NUM_FEATS);
+	*num_types = output_types;
+	double** out= new double*[output_types];
+	for(int i = 0; i < num_values; i++){
+		fscanf(file_pointer, "%*d,");
+		for(int j = 0; j < output_types; j++){
+			if( i == 0){
+				out[j] = new double[num_values];
+			}
+			fscanf(file_pointer, "%lf,", out[j] + i);
+			out[j][i] = check_num(out[j][i]);
+		}
+		if(i != num_values-1){
+			fscanf(file_pointer, "%*s\n");
+		}
+	}
+	fclose(file_pointer);
+	return out;
+}
+
+//Writes a features file like the ones the simulation makes, with values of the same length as the example in load_output().
+void write_features (char* file_name, int file) {
+	FILE* file_pointer = fopen(file_name, "w");
+	fprintf(file_pointer, "set,");
+	for(int j = 0; j < BENCH_FEATURES; j++){
+		fprintf(file_pointer, "feature %d wildtype,", j);
+	}
+	fprintf(file_pointer, "\n");
+	for(int i = 0; i < BENCH_SETS; i++){
+		fprintf(file_pointer, "%d,", i);
+		for(int j = 0; j < BENCH_FEATURES; j++){
+			if((i + j + file) % 37 == 0){
+				fprintf(file_pointer, "-nan,");
+			} else{
+				fprintf(file_pointer, "%.30g,", (j + 1) * 3.14159265358979 / (i + file + 1));
+			}
+		}
+		fprintf(file_pointer, "PASSED\n");
+	}
+	fclose(file_pointer);
+}
+
+double seconds () {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+void free_names (int num_types, char** names) {
+	if(names == NULL) return;
+	for(int j = 0; j < num_types; j++){
+		delete[] names[j];
+	}
+	delete[] names;
+}
+
+void free_output (double** output, int num_types) {
+	for(int j = 0; j < num_types; j++){
+		delete[] output[j];
+	}
+	delete[] output;
+}
+
+/*	Reads every file repetitions times with one parser and returns the average time per file in microseconds. The nominal file (the first) is read with its names, like collect_job() does.
+	which is 0 for the fscanf parser, 1 for load_output() and 2 for load_output() with a cached layout.
+*/
+double time_parser (int which, char** files, int repetitions) {
+	output_layout layout;
+	double start = seconds();
+	for(int r = 0; r < repetitions; r++){
+		for(int f = 0; f < BENCH_FILES; f++){
+			int num_types = 0;
+			char** names = NULL;
+			char*** want_names = (f == 0 ? &names : NULL);
+			if(which == 0){
+				free_output(fscanf_load_output(BENCH_SETS, &num_types, files[f], want_names), num_types);
+			} else{
+				delete load_output(BENCH_SETS, &num_types, files[f], want_names, (which == 2 ? &layout : NULL), NULL);
+			}
+			free_names(num_types, names);
+		}
+	}
+	return (seconds() - start) * 1e6 / ((double)repetitions * BENCH_FILES);
+}
+
+int main (int argc, char** argv) {
+	int repetitions = (argc > 1 ? atoi(argv[1]) : 200);
+	const char* dir = (argc > 2 ? argv[2] : "/tmp");
+	if(repetitions < 1){
+		usage("The number of repetitions must be a positive integer.", 1);
+	}
+	char* files[BENCH_FILES];
+	for(int f = 0; f < BENCH_FILES; f++){
+		files[f] = (char*)mallocate(strlen(dir) + 40);
+		sprintf(files[f], "%s/load-output-bench-%d-%d", dir, (int)getpid(), f);
+		write_features(files[f], f);
+	}
+	
+	//Both parsers have to read the same values and names.
+	for(int f = 0; f < BENCH_FILES; f++){
+		int old_types = 0, new_types = 0;
+		char** old_names = NULL;
+		char** new_names = NULL;
+		double** old_output = fscanf_load_output(BENCH_SETS, &old_types, files[f], &old_names);
+		matrix* new_output = load_output(BENCH_SETS, &new_types, files[f], &new_names, NULL, NULL);
+		bool same = (old_types == new_types);
+		//load_output() keeps every set in a column, while the old parser kept every feature in a row.
+		for(int j = 0; same && j < new_types; j++){
+			same = (strcmp(old_names[j], new_names[j]) == 0);
+			for(int i = 0; same && i < BENCH_SETS; i++){
+				same = (old_output[j][i] == new_output->at(j, i));
+			}
+		}
+		free_output(old_output, old_types);
+		free_names(old_types, old_names);
+		delete new_output;
+		free_names(new_types, new_names);
+		if(!same){
+			cout << "The parsers read different results from " << files[f] << "\n";
+			return 1;
+		}
+	}
+	
+	cout << BENCH_FEATURES << " features x " << BENCH_SETS << " sets, " << repetitions << " x " << BENCH_FILES << " files\n";
+	double old_time = time_parser(0, files, repetitions);
+	double new_time = time_parser(1, files, repetitions);
+	double cached_time = time_parser(2, files, repetitions);
+	cout << "fscanf parser:                " << old_time << " us/file\n";
+	cout << "load_output:                  " << new_time << " us/file (" << old_time / new_time << "x)\n";
+	cout << "load_output with the layout:  " << cached_time << " us/file (" << old_time / cached_time << "x)\n";
+	
+	for(int f = 0; f < BENCH_FILES; f++){
+		unlink(files[f]);
+		mfree(files[f]);
+	}
+	return 0;
+}
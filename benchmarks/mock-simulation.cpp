@@ -0,0 +1,253 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+mock-simulation.cpp is a stand-in for the simulation program, which speaks the same protocol as sogen-deterministic/simulation so that sensitivity can be benchmarked without it.
+Build it with "scons mock" (or "scons benchmarks") and pass it to sensitivity as -e benchmarks/mock-simulation, followed by its own options after --sim-args:
+	--features [int]         : the number of output features, default=10.
+	--latency [float]        : the time every parameter set takes to simulate, in milliseconds, default=0.
+	--latency-spread [float] : how much the time of a set varies, as a fraction of --latency: every set takes a time drawn uniformly from latency*(1 +- spread), default=0.
+	--failure-rate [float]   : the probability that a job fails, which makes a single simulation exit with a failure status and a persistent worker report a failed job, default=0.
+The features of a set are a smooth function of its parameters, so the sensitivities are the same in every run and with every mode of running the simulations. Only the latency and the failures are random, drawn by every process from --seed and its process id.
+*/
+
+#include <stdlib.h>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <unistd.h>
+#include <time.h>
+
+#include "../source/macros.hpp"
+
+using namespace std;
+
+//Struct for the options of the mock simulation.
+struct mock_params{
+	int pipe_in; //The descriptor the jobs are read from.
+	int pipe_out; //The descriptor the status of every job (--stream-jobs) and the binary results (--binary-results) are written to.
+	char* file_name; //The features file of a single simulation.
+	bool stream; //Whether jobs are read until SIM_JOB_SHUTDOWN instead of reading one.
+	bool binary; //Whether the results are sent through pipe_out instead of being written to the features file.
+	bool named; //Whether the names of the features have been sent already, which is only done once per process.
+	int features;
+	double latency; //In seconds per set.
+	double spread;
+	double failure_rate;
+	mock_params(){
+		pipe_in = -1;
+		pipe_out = -1;
+		file_name = NULL;
+		stream = false;
+		binary = false;
+		named = false;
+		features = 10;
+		latency = 0;
+		spread = 0;
+		failure_rate = 0;
+	}
+};
+
+//Reads exactly size bytes from fd into buffer. Returns false if the pipe was closed first.
+bool read_all (int fd, void* buffer, size_t size) {
+	char* pos = (char*)buffer;
+	while(size > 0){
+		ssize_t got = read(fd, pos, size);
+		if(got <= 0) return false;
+		pos += got;
+		size -= got;
+	}
+	return true;
+}
+
+//Writes exactly size bytes from buffer to fd. Returns false if the write failed.
+bool write_all (int fd, const void* buffer, size_t size) {
+	const char* pos = (const char*)buffer;
+	while(size > 0){
+		ssize_t put = write(fd, pos, size);
+		if(put <= 0) return false;
+		pos += put;
+		size -= put;
+	}
+	return true;
+}
+
+//Returns output feature k of the parameter set params (dims values), which every parameter contributes to with a weight of 1 to 5.
+double feature (int k, int dims, double* params) {
+	double value = 1;
+	for(int i = 0; i < dims; i++){
+		double weight = 1 + (7 * i + 3 * k) % 5;
+		value += weight * params[i] * (1 + 0.01 * params[i]);
+	}
+	return value;
+}
+
+//Sleeps for the simulated time of sets parameter sets.
+void simulate_latency (mock_params& mp, int sets) {
+	if(mp.latency <= 0){
+		return;
+	}
+	double total = 0;
+	for(int s = 0; s < sets; s++){
+		total += mp.latency * (1 + mp.spread * (2 * drand48() - 1));
+	}
+	if(total <= 0){
+		return;
+	}
+	struct timespec wait_for;
+	wait_for.tv_sec = (time_t)total;
+	wait_for.tv_nsec = (long)((total - wait_for.tv_sec) * 1e9);
+	while(nanosleep(&wait_for, &wait_for) == -1);
+}
+
+/*	Reads one job (the two ints of write_info() and the parameter sets) from mp.pipe_in and writes its results to file_name, or to mp.pipe_out with --binary-results.
+	Returns 0 if the job succeeded, 1 if it failed and -1 if the job could not be read.
+*/
+int run_job (mock_params& mp, char* file_name) {
+	int info[2];
+	if(!read_all(mp.pipe_in, info, sizeof(info)) || info[0] < 1 || info[1] < 0){
+		return -1;
+	}
+	int dims = info[0];
+	int sets = info[1];
+	double* params = new double[(size_t)dims * sets];
+	if(!read_all(mp.pipe_in, params, sizeof(double) * (size_t)dims * sets)){
+		delete[] params;
+		return -1;
+	}
+	simulate_latency(mp, sets);
+	if(drand48() < mp.failure_rate){
+		delete[] params;
+		return 1;
+	}
+	//Persistent workers send the status of a job before its binary results, or once its features file has been written.
+	int status = 0;
+	bool good = true;
+	if(mp.binary){
+		good = (!mp.stream || write_all(mp.pipe_out, &status, sizeof(int))) && write_all(mp.pipe_out, &mp.features, sizeof(int));
+		for(int k = 0; k < mp.features && !mp.named && good; k++){
+			char name[32];
+			int length = sprintf(name, "feature %d", k);
+			good = write_all(mp.pipe_out, &length, sizeof(int)) && write_all(mp.pipe_out, name, length);
+		}
+		mp.named = true;
+		double* values = new double[mp.features];
+		for(int s = 0; s < sets && good; s++){
+			for(int k = 0; k < mp.features; k++){
+				values[k] = feature(k, dims, params + (size_t)s * dims);
+			}
+			good = write_all(mp.pipe_out, values, sizeof(double) * mp.features);
+		}
+		delete[] values;
+	} else{
+		FILE* file = fopen(file_name, "w");
+		good = (file != NULL);
+		if(good){
+			fprintf(file, "set,");
+			for(int k = 0; k < mp.features; k++){
+				fprintf(file, "feature %d,", k);
+			}
+			fprintf(file, "\n");
+			for(int s = 0; s < sets; s++){
+				fprintf(file, "%d,", s);
+				for(int k = 0; k < mp.features; k++){
+					fprintf(file, "%.17g,", feature(k, dims, params + (size_t)s * dims));
+				}
+				fprintf(file, "PASSED\n");
+			}
+			good = (fclose(file) == 0);
+		}
+		good = good && (!mp.stream || write_all(mp.pipe_out, &status, sizeof(int)));
+	}
+	delete[] params;
+	return (good ? 0 : -1);
+}
+
+/*	Runs the jobs sent by a sensitivity run that was started with --persistent until it is sent SIM_JOB_SHUTDOWN or its job pipe is closed.
+*/
+int run_stream (mock_params& mp) {
+	while(true){
+		int header[2];
+		if(!read_all(mp.pipe_in, header, sizeof(int)) || header[0] != SIM_JOB_NEXT){
+			return 0;
+		}
+		if(!read_all(mp.pipe_in, header + 1, sizeof(int)) || header[1] < 0){
+			return 1;
+		}
+		char* file_name = new char[header[1] + 1];
+		if(!read_all(mp.pipe_in, file_name, header[1])){
+			delete[] file_name;
+			return 1;
+		}
+		file_name[header[1]] = '\0';
+		int result = run_job(mp, file_name);
+		delete[] file_name;
+		if(result == -1){
+			return 1;
+		}
+		if(result != 0 && !write_all(mp.pipe_out, &result, sizeof(int))){
+			return 1;
+		}
+	}
+}
+
+int main (int argc, char** argv) {
+	mock_params mp;
+	long seed = 0;
+	for(int i = 1; i < argc; i++){
+		const char* option = argv[i];
+		const char* value = (i + 1 < argc ? argv[i + 1] : "");
+		if(strcmp(option, "--stream-jobs") == 0){
+			mp.stream = true;
+			continue;
+		} else if(strcmp(option, "--binary-results") == 0){
+			mp.binary = true;
+			continue;
+		} else if(strcmp(option, "--pipe-in") == 0){
+			mp.pipe_in = atoi(value);
+		} else if(strcmp(option, "--pipe-out") == 0){
+			mp.pipe_out = atoi(value);
+		} else if(strcmp(option, "--print-osc-features") == 0){
+			mp.file_name = argv[i + 1];
+		} else if(strcmp(option, "--seed") == 0){
+			seed = atol(value);
+		} else if(strcmp(option, "--features") == 0){
+			mp.features = atoi(value);
+		} else if(strcmp(option, "--latency") == 0){
+			mp.latency = atof(value) / 1000;
+		} else if(strcmp(option, "--latency-spread") == 0){
+			mp.spread = atof(value);
+		} else if(strcmp(option, "--failure-rate") == 0){
+			mp.failure_rate = atof(value);
+		} else{
+			fprintf(stderr, "mock-simulation: unknown option %s\n", option);
+			return SIM_FAILURE_STATUS;
+		}
+		i++;
+	}
+	if(mp.pipe_in == -1 || (mp.stream || mp.binary ? mp.pipe_out == -1 : mp.file_name == NULL) || mp.features < 1 || mp.features > MAX_NUM_FEATS){
+		fprintf(stderr, "mock-simulation: needs --pipe-in, --pipe-out or --print-osc-features, and between 1 and %d --features\n", MAX_NUM_FEATS);
+		return SIM_FAILURE_STATUS;
+	}
+	//Every process draws its own latencies and failures, which still follow the seed of the run.
+	srand48(seed * 1000003 + getpid());
+	if(mp.stream){
+		return run_stream(mp);
+	}
+	return (run_job(mp, mp.file_name) == 0 ? 0 : SIM_FAILURE_STATUS);
+}
@@ -0,0 +1,168 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+morris-check.cpp checks --method morris against the local sensitivities with the mock simulation (see mock-simulation.cpp), whose features are nearly linear in every parameter, so that the mean elementary effect of a parameter (mu) is close to its local sensitivity.
+It runs both methods for 12 and 52 parameters, where the rows of the trajectories are padded to whole cache lines (see matrix.hpp), and exits with a failure status if any mu is off by more than CHECK_TOLERANCE of the sensitivity.
+Build it with "scons benchmarks" and run it from the root of the package, where it expects ./sensitivity and ./benchmarks/mock-simulation:
+	./benchmarks/morris-check [directory]
+Its files are written to [directory], default=/tmp.
+*/
+
+#include <stdlib.h>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+//The largest difference between mu and the local sensitivity, relative to the sensitivity. Over +/- 5% the elementary effects of the mock differ from its derivative by well under 1%.
+#define CHECK_TOLERANCE 0.01
+#define CHECK_FEATURES 5
+
+/*	Runs sensitivity once with the given arguments (a NULL terminated array), with its output thrown away.
+	Returns false if it did not exit successfully.
+*/
+bool run (char** args) {
+	pid_t pid = fork();
+	if(pid == -1){
+		return false;
+	}
+	if(pid == 0){
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		dup2(null_fd, STDERR_FILENO);
+		execv(args[0], args);
+		_exit(1);
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+/*	Reads the dims x CHECK_FEATURES values of a results file written by write_sensitivity() (see io.cpp) into values.
+	Returns false if the file is missing or has fewer values.
+*/
+bool read_results (const char* name, int dims, double* values) {
+	FILE* file = fopen(name, "r");
+	if(file == NULL){
+		return false;
+	}
+	char line[16384];
+	int rows = 0;
+	//The first line holds the names of the features.
+	bool read = (fgets(line, sizeof(line), file) != NULL);
+	while(read && rows < dims && fgets(line, sizeof(line), file) != NULL){
+		char* pos = strchr(line, ',');
+		for(int j = 0; j < CHECK_FEATURES && pos != NULL; j++){
+			char* end = NULL;
+			values[rows * CHECK_FEATURES + j] = strtod(pos + 1, &end);
+			read = read && end != pos + 1;
+			pos = strchr(end, ',');
+			read = read && (pos != NULL || j + 1 == CHECK_FEATURES);
+		}
+		rows++;
+	}
+	fclose(file);
+	return read && rows == dims;
+}
+
+/*	Runs both methods on one nominal set of dims parameters and compares mu with the local sensitivities.
+	Returns the number of values that are off, or -1 if a run failed.
+*/
+int check_dims (const char* dir, int dims) {
+	char nominal_file[256];
+	char data_dir[256];
+	char lsa_dir[256];
+	char morris_dir[256];
+	snprintf(nominal_file, sizeof(nominal_file), "%s/morris-check-%d.params", dir, (int)getpid());
+	snprintf(data_dir, sizeof(data_dir), "%s/morris-check-%d-data", dir, (int)getpid());
+	snprintf(lsa_dir, sizeof(lsa_dir), "%s/morris-check-%d-lsa", dir, (int)getpid());
+	snprintf(morris_dir, sizeof(morris_dir), "%s/morris-check-%d-morris", dir, (int)getpid());
+	FILE* nominal = fopen(nominal_file, "w");
+	if(nominal == NULL){
+		fprintf(stderr, "Could not write %s\n", nominal_file);
+		return -1;
+	}
+	for(int i = 0; i < dims; i++){
+		fprintf(nominal, "%g%s", 1 + 0.5 * (i % 7), (i + 1 < dims ? "," : "\n"));
+	}
+	fclose(nominal);
+	
+	char features[16];
+	snprintf(features, sizeof(features), "%d", CHECK_FEATURES);
+	const char* methods[2][3] = {{"lsa", lsa_dir, NULL}, {"morris", morris_dir, NULL}};
+	bool ran = true;
+	for(int m = 0; m < 2 && ran; m++){
+		char* args[] = {(char*)"./sensitivity", (char*)"-P", (char*)"2", (char*)"-p", (char*)"5", (char*)"-s", (char*)"1", (char*)"-l", (char*)"2",
+			(char*)"-M", (char*)methods[m][0], (char*)"-n", nominal_file, (char*)"-D", data_dir, (char*)"-d", (char*)methods[m][1],
+			(char*)"-e", (char*)"./benchmarks/mock-simulation", (char*)"--sim-args", (char*)"--features", features, NULL};
+		ran = run(args);
+	}
+	
+	double* lsa = new double[dims * CHECK_FEATURES];
+	double* mu = new double[dims * CHECK_FEATURES];
+	char name[300];
+	snprintf(name, sizeof(name), "%s/LSA_0", lsa_dir);
+	ran = ran && read_results(name, dims, lsa);
+	snprintf(name, sizeof(name), "%s/mu_0", morris_dir);
+	ran = ran && read_results(name, dims, mu);
+	int off = (ran ? 0 : -1);
+	for(int i = 0; i < dims * CHECK_FEATURES && ran; i++){
+		if(!(fabs(mu[i] - lsa[i]) <= CHECK_TOLERANCE * fabs(lsa[i]))){
+			if(off < 5){
+				printf("\tparameter %d, feature %d: mu=%g, sensitivity=%g\n", i / CHECK_FEATURES, i % CHECK_FEATURES, mu[i], lsa[i]);
+			}
+			off++;
+		}
+	}
+	delete[] lsa;
+	delete[] mu;
+	
+	unlink(nominal_file);
+	char command[1024];
+	snprintf(command, sizeof(command), "rm -rf %s %s %s", data_dir, lsa_dir, morris_dir);
+	if(system(command) != 0){
+		fprintf(stderr, "Could not remove %s, %s and %s\n", data_dir, lsa_dir, morris_dir);
+	}
+	return off;
+}
+
+int main (int argc, char** argv) {
+	const char* dir = (argc > 1 ? argv[1] : "/tmp");
+	if(access("./sensitivity", X_OK) != 0 || access("./benchmarks/mock-simulation", X_OK) != 0){
+		fprintf(stderr, "Run this from the root of the package after building sensitivity and the benchmarks.\n");
+		return 1;
+	}
+	int sizes[] = {12, 52};
+	bool passed = true;
+	for(int s = 0; s < 2; s++){
+		int off = check_dims(dir, sizes[s]);
+		if(off == -1){
+			printf("%d parameters: sensitivity failed\n", sizes[s]);
+		} else{
+			printf("%d parameters: %d of %d values of mu differ from the sensitivity by more than %g%%\n", sizes[s], off, sizes[s] * CHECK_FEATURES, 100 * CHECK_TOLERANCE);
+		}
+		passed = passed && off == 0;
+	}
+	printf(passed ? "passed\n" : "FAILED\n");
+	return (passed ? 0 : 1);
+}
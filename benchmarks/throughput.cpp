@@ -0,0 +1,199 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+throughput.cpp is an end-to-end benchmark of sensitivity with the mock simulation (see mock-simulation.cpp), which runs the same analysis with every way of running the simulations and a range of --processes and reports how many simulations were run per second.
+Build it with "scons benchmarks" and run it from the root of the package, where it expects ./sensitivity and ./benchmarks/mock-simulation:
+	./benchmarks/throughput [nominal sets] [parameters] [latency] [features] [directory]
+The latency is the time the mock simulation takes per parameter set, in milliseconds. The nominal sets file and the data of every run are written to [directory], default=/tmp.
+With a latency, the efficiency of a run is the time the simulations would take if they were perfectly spread over the processes, divided by the time the run took.
+*/
+
+#include <stdlib.h>
+#include <cstring>
+#include <cstdio>
+#include <unistd.h>
+#include <time.h>
+#include <fcntl.h>
+#include <sys/wait.h>
+
+using namespace std;
+
+#define BENCH_POINTS 2
+
+//The ways of running the simulations that are compared, as sensitivity options.
+static const char* modes[][4] = {
+	{"", NULL},
+	{"binary", "--binary-results", NULL},
+	{"memory", "--memory-data", NULL},
+	{"persistent", "--persistent", NULL},
+	{"persistent+binary", "--persistent", "--binary-results", NULL},
+};
+#define BENCH_MODES 5
+
+double seconds () {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/*	Runs sensitivity once with the given arguments (a NULL terminated array), with its output thrown away. The arguments have to include --stats stats_file, since sensitivity does not always exit with a failure status when it fails, but always reports the failure there.
+	Returns the time it took in seconds, or -1 if it failed.
+*/
+double time_run (char** args, const char* stats_file) {
+	unlink(stats_file);
+	double start = seconds();
+	pid_t pid = fork();
+	if(pid == -1){
+		return -1;
+	}
+	if(pid == 0){
+		int null_fd = open("/dev/null", O_WRONLY);
+		dup2(null_fd, STDOUT_FILENO);
+		dup2(null_fd, STDERR_FILENO);
+		execv(args[0], args);
+		_exit(1);
+	}
+	int status = 0;
+	waitpid(pid, &status, 0);
+	double wall = seconds() - start;
+	if(!WIFEXITED(status) || WEXITSTATUS(status) != 0){
+		return -1;
+	}
+	//The report ends with whether the run failed.
+	char report[4096];
+	FILE* file = fopen(stats_file, "r");
+	if(file == NULL){
+		return -1;
+	}
+	size_t length = fread(report, 1, sizeof(report) - 1, file);
+	fclose(file);
+	report[length] = '\0';
+	const char* failed = NULL;
+	for(const char* found = strstr(report, "\"failed\": "); found != NULL; found = strstr(found + 1, "\"failed\": ")){
+		failed = found;
+	}
+	if(failed == NULL || strncmp(failed, "\"failed\": false", 15) != 0){
+		return -1;
+	}
+	return wall;
+}
+
+int main (int argc, char** argv) {
+	int num_sets = (argc > 1 ? atoi(argv[1]) : 4);
+	int dims = (argc > 2 ? atoi(argv[2]) : 20);
+	const char* latency = (argc > 3 ? argv[3] : "0");
+	const char* features = (argc > 4 ? argv[4] : "10");
+	const char* dir = (argc > 5 ? argv[5] : "/tmp");
+	if(num_sets < 1 || dims < 1){
+		fprintf(stderr, "The number of nominal sets and parameters must be positive integers.\n");
+		return 1;
+	}
+	if(access("./sensitivity", X_OK) != 0 || access("./benchmarks/mock-simulation", X_OK) != 0){
+		fprintf(stderr, "Run this from the root of the package after building sensitivity and the benchmarks.\n");
+		return 1;
+	}
+	
+	//Every nominal set has the same number of parameters, none of them 0, since parameters of 0 are not simulated.
+	char nominal_file[256];
+	char data_dir[256];
+	char sense_dir[256];
+	char stats_file[256];
+	snprintf(nominal_file, sizeof(nominal_file), "%s/throughput-bench-%d.params", dir, (int)getpid());
+	snprintf(data_dir, sizeof(data_dir), "%s/throughput-bench-%d-data", dir, (int)getpid());
+	snprintf(sense_dir, sizeof(sense_dir), "%s/throughput-bench-%d-sensitivities", dir, (int)getpid());
+	snprintf(stats_file, sizeof(stats_file), "%s/throughput-bench-%d.json", dir, (int)getpid());
+	FILE* nominal = fopen(nominal_file, "w");
+	if(nominal == NULL){
+		fprintf(stderr, "Could not write %s\n", nominal_file);
+		return 1;
+	}
+	for(int s = 0; s < num_sets; s++){
+		for(int i = 0; i < dims; i++){
+			fprintf(nominal, "%g%s", 1 + 0.5 * ((i + s) % 7), (i + 1 < dims ? "," : "\n"));
+		}
+	}
+	fclose(nominal);
+	
+	//The processes are doubled up to the number of CPUs.
+	int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	int simulations = num_sets * (dims * 2 * BENCH_POINTS + 1);
+	double per_set = atof(latency) / 1000;
+	printf("%d nominal sets x %d parameters, %d simulations of %s ms, %s features\n", num_sets, dims, simulations, latency, features);
+	printf("%-20s %9s %10s %14s %10s\n", "mode", "processes", "seconds", "simulations/s", "efficiency");
+	char count[16];
+	char processes[16];
+	char points[16];
+	snprintf(count, sizeof(count), "%d", num_sets);
+	snprintf(points, sizeof(points), "%d", BENCH_POINTS);
+	for(int m = 0; m < BENCH_MODES; m++){
+		for(int p = 1; ; p = (p * 2 < cpus ? p * 2 : cpus)){
+			snprintf(processes, sizeof(processes), "%d", p);
+			char* args[40];
+			int n = 0;
+			args[n++] = (char*)"./sensitivity";
+			args[n++] = (char*)"-c";
+			args[n++] = count;
+			args[n++] = (char*)"-P";
+			args[n++] = points;
+			args[n++] = (char*)"-l";
+			args[n++] = processes;
+			args[n++] = (char*)"-s";
+			args[n++] = (char*)"1";
+			args[n++] = (char*)"-z";
+			args[n++] = (char*)"-n";
+			args[n++] = nominal_file;
+			args[n++] = (char*)"-D";
+			args[n++] = data_dir;
+			args[n++] = (char*)"-d";
+			args[n++] = sense_dir;
+			args[n++] = (char*)"--stats";
+			args[n++] = stats_file;
+			for(int o = 1; modes[m][o] != NULL; o++){
+				args[n++] = (char*)modes[m][o];
+			}
+			args[n++] = (char*)"-e";
+			args[n++] = (char*)"./benchmarks/mock-simulation";
+			args[n++] = (char*)"--sim-args";
+			args[n++] = (char*)"--features";
+			args[n++] = (char*)features;
+			args[n++] = (char*)"--latency";
+			args[n++] = (char*)latency;
+			args[n] = NULL;
+			double wall = time_run(args, stats_file);
+			const char* name = (modes[m][0][0] == '\0' ? "default" : modes[m][0]);
+			if(wall < 0){
+				printf("%-20s %9d %10s\n", name, p, "failed");
+			} else if(per_set > 0){
+				printf("%-20s %9d %10.3f %14.1f %9.1f%%\n", name, p, wall, simulations / wall, 100 * simulations * per_set / (p * wall));
+			} else{
+				printf("%-20s %9d %10.3f %14.1f %10s\n", name, p, wall, simulations / wall, "-");
+			}
+			if(p >= cpus) break;
+		}
+	}
+	
+	unlink(nominal_file);
+	unlink(stats_file);
+	char command[1024];
+	snprintf(command, sizeof(command), "rm -rf %s %s", data_dir, sense_dir);
+	if(system(command) != 0){
+		fprintf(stderr, "Could not remove %s and %s\n", data_dir, sense_dir);
+	}
+	return 0;
+}
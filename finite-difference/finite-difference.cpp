@@ -35,26 +35,36 @@ using namespace std;
 	and the array indecies should align properly such that:
 		dependent[i] = y_i = f( x_i ) = f( independent[i] )
 	where f(x) is the output function for which we are calculating the finite difference.
+	The points are assumed to be evenly spread on both sides of x, without x itself (as in the chart in finite-difference.hpp). If there are more than ACC_MAX points, only the ACC_MAX points closest to x are used.
 */
 void fdy_fdx (int accuracy, double delta_independent, double* dependent, double* fin_dif_output, double* round_error) {
-	fin_dif_coef fdc(accuracy);
-	double numerator = sum_num(dependent, fdc);
-	double fin_dif;
-	double rerr = 0;
-	if( isinf(numerator) != 0 ){
-		fin_dif = INFINITY;
-		rerr = INFINITY;
-	}else if (delta_independent == 0){
-		fin_dif = 0;
-		rerr = 0;
-	} else{
-		fin_dif  = numerator / delta_independent;
-		rerr = numerator - (fin_dif * delta_independent);
+	fdy_fdx_all(accuracy, 1, delta_independent, dependent, 1, fin_dif_output, round_error);
+}
+
+/*	The batched version of fdy_fdx(), which calculates the finite differences of count features in one pass: feature j has its num_points values at dependent[j + i*point_step], and its finite difference is stored in fin_dif_output[j].
+	round_error is either NULL or an array of count round errors. The stencil is chosen once for all features, and nothing is allocated.
+*/
+void fdy_fdx_all (int num_points, int count, double delta_independent, const double* dependent, size_t point_step, double* fin_dif_output, double* round_error) {
+	int accuracy = stencil_accuracy(num_points);
+	//Center the stencil on the points closest to x.
+	if(num_points > accuracy){
+		dependent += ((num_points - accuracy) / 2) * point_step;
 	}
-	if(round_error != NULL){
-		*round_error =  rerr;
+	switch (accuracy)
+	{
+		case 8:
+			stencil_batch<8>(count, delta_independent, dependent, point_step, fin_dif_output, round_error);
+			break;
+		case 6:
+			stencil_batch<6>(count, delta_independent, dependent, point_step, fin_dif_output, round_error);
+			break;
+		case 4:
+			stencil_batch<4>(count, delta_independent, dependent, point_step, fin_dif_output, round_error);
+			break;
+		default:
+			stencil_batch<2>(count, delta_independent, dependent, point_step, fin_dif_output, round_error);
+			break;
 	}
-	*fin_dif_output = fin_dif;
 }
 
 /*	Simple function for adding up the numerator for the finite difference calculation.
@@ -89,15 +99,8 @@ double sum_num (double* dependent, fin_dif_coef& fdc) {
 disregarding error -- this is dangerous.
 */
 double finite_difference (int num_points, double step_size, double* function_values) {
-	int output_shift = 0;
-	num_points -= num_points % 2;
-	if(num_points > ACC_MAX){
-		output_shift += ACC_MAX / 2;
-	}
-	
 	double fin_dif;
-	fdy_fdx(num_points - output_shift, step_size, function_values, &fin_dif, NULL);
+	fdy_fdx(num_points, step_size, function_values, &fin_dif, NULL);
 
 	return fin_dif;
 }
-
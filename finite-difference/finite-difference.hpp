@@ -32,6 +32,9 @@ finite-difference.hpp contains function declarations, macros, and structs for fi
 #include <cmath>
 #include <errno.h>
 #endif
+#if defined(__SSE2__)
+#include <emmintrin.h>	//(Calculating the finite differences of two features at once.)
+#endif
 
 //Min and max accuracy macros and a nested boolean function that returns min if num<min, max if max<num, and num otherwise.
 #define ACC_MAX 8
@@ -59,59 +62,119 @@ Accuracy
 
 using namespace std;
 
+/*	The coefficients of the central difference stencils, with a row for each accuracy: FD_COEF[accuracy/2 - 1][i] is the coefficient of the i'th point from the left, and only the first accuracy entries of a row are used.
+	The table is constexpr, so the stencil templates below see every coefficient as a constant.
+*/
+constexpr double FD_COEF[ACC_MAX / 2][ACC_MAX] = {C_TWO, C_FOUR, C_SIX, C_EIGHT};
+
+//Returns the accuracy of the stencil used for num_points points: the largest even number of points up to ACC_MAX, and at least ACC_MIN.
+inline int stencil_accuracy (int num_points) {
+	return minmax(ACC_MIN, num_points - (num_points % 2), ACC_MAX);
+}
+
 //Struct declaration -- this struct takes care of holding the correct coefficients based on the accuracy value given.
 struct fin_dif_coef{
 	int accuracy;
-	double* coef;
+	const double* coef;
 	
-	//Constructor takes an accuracy value, a, ensures it is valid value, then allocates coef to be the appopriate size and fills it in based of the macro values.
+	//Constructor takes an accuracy value, a, and ensures it is valid value. coef then points at the row of FD_COEF for that accuracy, so nothing is allocated.
 	fin_dif_coef(int a){
 		accuracy = a + (a % 2); //This ensures that accuracy=a if a is even, but accuracy = a+1 if a is odd.
 		accuracy = minmax(ACC_MIN, accuracy, ACC_MAX); //This ensures a is one of the hard-coded acceptible values.
-		//This switch statement determines how coef should be filled depending on the accuracy value.
-		switch (accuracy)
-		{
-			case 8:{
-				double temp8[8] = C_EIGHT;
-				this->fill(temp8); 
-				break;
-			}
-			case 6:{
-				double temp6[6] = C_SIX;
-				this->fill(temp6);
-				break;
-			}
-			case 4:{
-				double temp4[4] = C_FOUR;
-				this->fill(temp4);
-				break;
-			}
-			default:{
-				double temp2[2] = C_TWO;
-				this->fill(temp2);
-				break;
-			}
-		}
-			
+		coef = FD_COEF[accuracy / 2 - 1];
 	}
-	
-	~fin_dif_coef(){
-		delete[] this->coef;
+};
+
+/*	stencil<ACC, I> adds terms I through ACC-1 of the numerator of a finite difference with accuracy ACC, with the same infinity and NaN handling as sum_num(): NaN values are skipped and infinite values are counted in inf.
+	The recursion is resolved at compile time, so the sum is fully unrolled with every coefficient a constant. The values of one feature are point_step apart.
+	add_pair() does the same for two neighbouring features at once with SSE2, for the batched fdy_fdx_all().
+*/
+template<int ACC, int I>
+struct stencil{
+	static inline void add (const double* dependent, size_t point_step, double& numerator, int& inf) {
+		double next = dependent[I * point_step];
+		inf += (fabs(next) == INFINITY);
+		numerator += (fabs(next) < INFINITY ? next * FD_COEF[ACC / 2 - 1][I] : 0);
+		stencil<ACC, I + 1>::add(dependent, point_step, numerator, inf);
 	}
-	
-	//This just loops through the macro coef values and puts them in the coef array.
-	void fill(double* source){
-		this->coef = new double[this->accuracy];
-		for(int i = 0; i < this->accuracy; i++){
-			this->coef[i] = source[i];
-		}
+#if defined(__SSE2__)
+	static inline void add_pair (const double* dependent, size_t point_step, __m128d& numerator, __m128d& inf) {
+		const __m128d next = _mm_loadu_pd(dependent + I * point_step);
+		const __m128d size = _mm_andnot_pd(_mm_set1_pd(-0.0), next);
+		const __m128d infinity = _mm_set1_pd(INFINITY);
+		inf = _mm_add_pd(inf, _mm_and_pd(_mm_cmpeq_pd(size, infinity), _mm_set1_pd(1)));
+		numerator = _mm_add_pd(numerator, _mm_and_pd(_mm_cmplt_pd(size, infinity), _mm_mul_pd(next, _mm_set1_pd(FD_COEF[ACC / 2 - 1][I]))));
+		stencil<ACC, I + 1>::add_pair(dependent, point_step, numerator, inf);
 	}
+#endif
 };
 
+//The end of the recursion.
+template<int ACC>
+struct stencil<ACC, ACC>{
+	static inline void add (const double* , size_t , double& , int& ) {}
+#if defined(__SSE2__)
+	static inline void add_pair (const double* , size_t , __m128d& , __m128d& ) {}
+#endif
+};
+
+/*	Turns the numerator of a finite difference with accuracy points, of which inf were infinite, into the finite difference as sum_num() and fdy_fdx() do:
+	If every point is infinite the numerator is zero, if only some are it is infinite, and an infinite numerator gives an infinite finite difference and round error.
+*/
+inline double fin_dif_finish (int accuracy, double numerator, int inf, double delta_independent, double* round_error) {
+	if(inf != 0){
+		numerator = (inf == accuracy ? 0 : INFINITY);
+	}
+	double fin_dif;
+	double rerr;
+	if( isinf(numerator) != 0 ){
+		fin_dif = INFINITY;
+		rerr = INFINITY;
+	}else if (delta_independent == 0){
+		fin_dif = 0;
+		rerr = 0;
+	} else{
+		fin_dif  = numerator / delta_independent;
+		rerr = numerator - (fin_dif * delta_independent);
+	}
+	if(round_error != NULL){
+		*round_error = rerr;
+	}
+	return fin_dif;
+}
+
+/*	Calculates the finite differences of count features with an accuracy of ACC points. Feature j has its ACC values at dependent[j + i*point_step], i.e. the values of all features at one point are next to each other.
+	Two features are done at a time where SSE2 is available. Nothing is allocated. round_error may be NULL, otherwise it gets the round error of every feature.
+*/
+template<int ACC>
+void stencil_batch (int count, double delta_independent, const double* dependent, size_t point_step, double* fin_dif_output, double* round_error) {
+	int j = 0;
+#if defined(__SSE2__)
+	for(; j + 2 <= count; j += 2){
+		__m128d numerator = _mm_setzero_pd();
+		__m128d inf = _mm_setzero_pd();
+		stencil<ACC, 0>::add_pair(dependent + j, point_step, numerator, inf);
+		double numerators[2];
+		double infs[2];
+		_mm_storeu_pd(numerators, numerator);
+		_mm_storeu_pd(infs, inf);
+		for(int k = 0; k < 2; k++){
+			fin_dif_output[j + k] = fin_dif_finish(ACC, numerators[k], (int)infs[k], delta_independent, (round_error == NULL ? NULL : round_error + j + k));
+		}
+	}
+#endif
+	for(; j < count; j++){
+		double numerator = 0;
+		int inf = 0;
+		stencil<ACC, 0>::add(dependent + j, point_step, numerator, inf);
+		fin_dif_output[j] = fin_dif_finish(ACC, numerator, inf, delta_independent, (round_error == NULL ? NULL : round_error + j));
+	}
+}
+
 //Function declarations for finite-difference.cpp:
 double finite_difference(int num_points, double step_size, double* function_values);
 void fdy_fdx(int accuracy, double delta_independent, double* dependent, double* fin_dif_output, double* round_error);
+void fdy_fdx_all(int num_points, int count, double delta_independent, const double* dependent, size_t point_step, double* fin_dif_output, double* round_error);
 double sum_num(double* dependent, fin_dif_coef& fdc);
 
 #endif
-
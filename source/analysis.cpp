@@ -35,44 +35,47 @@ To normalize the sensitivities across the parameter set, for m parameters, the f
 
 #include "init.hpp"
 #include "io.hpp"
+#include "journal.hpp"
+#include "remote.hpp"
+#include "schedule.hpp"
+#include "stats.hpp"
+#include "threads.hpp"
 #include "../finite-difference/finite-difference.hpp"
 #include "macros.hpp"
 
 using namespace std;
 
-//The main() function does standard c++ main things -- it calls functions to initialze parameters based on commandline arguments, then distrbiutes the work to functions that perform the gathering of data and analysis.
+//The benchmarks (see benchmarks/analysis-kernels.cpp) link the analysis functions of this file but have their own main().
+#if !defined(BENCHMARK)
+//The main() function does standard c++ main things -- it calls functions to initialze parameters based on commandline arguments, then hands the work of gathering data and analysis to the scheduler. See schedule.cpp
 int main (int argc, char** argv) {
 	//Setup the parameter struct based on arguments. See init.cpp & init.hpp
 	input_params ip;
+	//If memory tracking was enabled at compilation, the heap usage can also be reported every MEMTRACK_INTERVAL seconds while the program runs.
+	#if defined(MEMTRACK)
+		start_heap_dumps(getenv("MEMTRACK_INTERVAL") != NULL ? atof(getenv("MEMTRACK_INTERVAL")) : 0);
+	#endif
 	accept_params(argc, argv, ip);
-	//Loop for processign multiple nominal parameter sets. Each step of the loop will do all of the sensitivity analysis based on one nominal parameter set, then increment ip.set_skip which will cause proceeding steps of the loop to read other nominal sets from the input file.
-	for(int which_nominal = 0; which_nominal < ip.num_nominal;  which_nominal ++){
-		//Read in the nominal parameter set from file.
-		read_nominal(ip);
-		//If ip.nominal is set to NULL after the read_nominal() call, this check exits the program.
-		if(ip.nominal == NULL) usage("Could not read nominal parameter set.", which_nominal); 
-
-		//Initializes the struct that holds sets that will be simulated and fills it in with the appropriate values.
-		sim_set ss(ip);
-	
-		//Send out the sets that need to be simulated to get data stored in files. Recycle checks to see whether the user indicated that the data has already been generated and, if so, assumes it can read the necessary files. 
-		//The recycle option is prone to failure if commandline arguments are inconsistent with previous runs. (There is a warning about this in the usage help.) 
-		if(!ip.recycle){
-			cout << "\n ~ Set: " << which_nominal << " -- Generating data ~ \n";
-			generate_data(ip, ss);
-		}
-		
-		//Ready to calculate the sensitivity. The LSA_all_dims() function takes care of reading the oscillations features files and performing the analysis.
-		//The generate_only option is useful when you only want the features files based on the perurbed parameters and don't need the sensitivity results.
-		if(!ip.generate_only){
-			cout << "\n ~ Set: " << which_nominal << " -- Calculating sensitivity ~ \n"; 
-			LSA_all_dims(ip, ss);
-		}
-		//The failure message is not NULL iff there was an error in the program.
-		if(ip.failure != NULL){
-			usage(ip.failure, ip.failcode);
-			break;
+	//A worker only simulates the jobs its coordinator sends it. See remote.cpp
+	if(ip.worker_address != NULL){
+		run_worker(ip);
+	} else{
+		//Process all the nominal parameter sets. The scheduler reads each nominal set from the input file, sends out the sets that need to be simulated and calculates the sensitivity of every set once its data has been generated.
+		open_stats(ip);
+		start_work_pool(ip);
+		if(ip.failure == NULL){
+			run_schedule(ip);
 		}
+		//The simulation processes are only shut down once every nominal set has been simulated.
+		stop_pool(ip);
+		stop_work_pool(ip);
+		close_stats(ip);
+		close_nominal(ip);
+		close_journal(ip);
+	}
+	//The failure message is not NULL iff there was an error in the program.
+	if(ip.failure != NULL){
+		usage(ip.failure, ip.failcode);
 	}
 	cout << "\n ~ Exiting ~ \n";
 	//If quiet mode was enabled, switch cout back on. 
@@ -83,134 +86,237 @@ int main (int argc, char** argv) {
 	#endif
 	return 0;
 }
-
-/*	This function does exactly what its name implies. 
-	The sim_set struct handles the work of how perterbations of parameter sets should be stored,
-	the simulate_samples() function in io.cpp takes care of the execution and parallelization. See init.hpp & io.cpp
-*/
-void generate_data (input_params& ip, sim_set& ss) {
-	//Run the simulation on the nominal set 
-	simulate_nominal(ip);
-	
-	//Dispatch the sets for perturbations of each dimension to the simulation program.
-	//Based on the input parameter for how many processes can be run, this will get ip.processes running deterministic simulatneously, each running the perturbed sets for a particular simulation dimension/parmater. 
-	int first_dim = 0;
-	int proc = ip.processes; //Temporarily holds on to the number of processes set for the input params so that the struct can have its value modified before it is passed to simulate_samples().
-	for(; first_dim < ip.dims; first_dim += proc){
-		if( (ip.dims - first_dim) < proc ){
-			ip.processes = ip.dims - first_dim;
-		}
-		simulate_samples(first_dim, ip, ss);
-		if(ip.failure != NULL) break;
-	}
-	ip.processes = proc; //Put ip.processes back to its original value.
-}
+#endif
 
 /*	This function calculates the local LSA_all_dims around the the nominal parameter set with respect to each parameter. 
 	It then normalizes the sensitivities of each feature to each parameter based on the parameter's fraction of the total sensitivity from all parameters. (See the normalize() function)
+	The simulation results have already been collected into run by collect_job() (see io.cpp), with the number of output features and their names taken from the nominal set.
+	The dimensions are differentiated by differentiate_dims(), shared out among the --analysis-threads (see threads.cpp). Each dimension only writes its own rows of lsa and round_errors, so the results do not depend on the threads, and the messages about every dimension are written in order afterwards.
 	This also makes the calls to write out the information to appropriate files. See io.cpp
 */
-void LSA_all_dims (input_params& ip, sim_set& ss) {
-	//First, load the output for the nominal set against which other values will be compared. This call also handles counting the number of output features and holding on to the output features names.
-	int num_dependent;
-	char* file_name = make_name(ip.data_dir, ip.nom_file, 0); //Make name just mallocates a string based on a directory+filename+integer combination.
-	char*** output_names = new char**[1]; //Holds a pointer to an array of strings, each of which is the name of an output feature.
-	double** nominal_output = load_output(1, &num_dependent, file_name, output_names); //Load output puts the data created by generate_data into a double[j][i] where j is the index of an output feature and i is the index of the value of that feature at a particular perturbation.
-	unmake_file(file_name, ip.delete_data); //Deletes a the features file if ip.delete_data is true.
-	mfree(file_name);
-	//Based on the above count (num_dependent), calculate the sensitivities of each output for each dimension.
-	double** dim_output;
-	double** lsa = new double*[ip.dims];
-	int i = 0;
-	for(; i < ip.dims; i++){
-		// Get simulation output for this particular dimension
-		file_name = make_name(ip.data_dir, ip.dim_file, i);
-		dim_output = load_output(ss.sets_per_dim, &num_dependent,file_name, NULL);
-		//Remove the simulation data file if ip.delete_data was set to true.
-		unmake_file(file_name, ip.delete_data);
-		mfree(file_name);
-		// Fills LSA array with derivative values
+void LSA_all_dims (input_params& ip, nominal_run& run) {
+	MEM_TAG(MEM_LSA);
+	sim_set& ss = *run.ss;
+	int num_dependent = run.num_features;
+	char* file_name;
+	//Based on the number of output features (num_dependent), calculate the sensitivities of each output for each dimension.
+	//The sensitivities of every feature to one dimension are next to each other, so that the finite differences of a dimension are calculated for all features in one pass.
+	matrix& lsa = *arena_matrix(run.arena, ip.dims, num_dependent, ROW_MAJOR);
+	//The round errors of every dimension, which are checked once all of them are in.
+	matrix& round_errors = *arena_matrix(run.arena, ip.dims, num_dependent, ROW_MAJOR);
+	double started = stat_clock(ip);
+	lsa_work work = {&run, &lsa, &round_errors};
+	if((double)ip.dims * num_dependent * ss.sets_per_dim < ANALYSIS_MIN_VALUES){
+		differentiate_dims(&work, 0, ip.dims);
+	} else{
+		run_work(ip, ip.dims, differentiate_dims, &work);
+	}
+	for(int i = 0; i < ip.dims; i++){
 		cout << "Parameter: " << i << "\n"; 
-		lsa[i] = fin_dif_one_dim(ss.sets_per_dim, num_dependent, (ip.nominal[i] * ss.step_per_set), dim_output);
-		// Scale each sensitivity value to remove dimensionalization
-		for (int j = 0; j < num_dependent; j++){
-			lsa[i][j] = non_dim_sense(ip.nominal[i], nominal_output[j][0], lsa[i][j]); 
+		if(!run.constant[i] && !run.failed[i + 1]){
+			check_round_errors(num_dependent, (run.nominal[i] * ss.step_per_set), round_errors.row(i));
 		}
-		//Delete the raw data.
-		del_double_2d(num_dependent, dim_output);
 	}
+	stat_add(ip, &run, STAT_DIFFERENTIATE, started);
 	//Write out the sensitivity and normalized sensitivity to the correct directory/files
-	file_name = make_name(ip.sense_dir, ip.sense_file, ip.set_skip - 1);
-	write_sensitivity(ip.dims, num_dependent, output_names[0], lsa, file_name);
+	started = stat_clock(ip);
+	file_name = make_name(ip.sense_dir, ip.sense_file, run.index);
+	write_sensitivity(ip.dims, num_dependent, run.output_names, lsa, file_name);
 	mfree(file_name);
+	stat_add(ip, &run, STAT_WRITE, started);
 	
 	//This call modifies lsa in place, so after the call to normalize(), lsa contains the normalized sensitivities.
-	normalize(ip.dims, num_dependent, lsa);
-	file_name = make_name(ip.sense_dir, ip.norm_file, ip.set_skip - 1);
-	write_sensitivity(ip.dims, num_dependent, output_names[0], lsa, file_name);
+	started = stat_clock(ip);
+	normalize(lsa);
+	//Normalizing counts a nan sensitivity as 0, but a parameter without a sensitivity has no share of the total either.
+	for(int i = 0; i < ip.dims; i++){
+		for(int j = 0; j < num_dependent && run.failed[i + 1]; j++){
+			lsa.row(i)[j] = NAN;
+		}
+	}
+	stat_add(ip, &run, STAT_NORMALIZE, started);
+	started = stat_clock(ip);
+	file_name = make_name(ip.sense_dir, ip.norm_file, run.index);
+	write_sensitivity(ip.dims, num_dependent, run.output_names, lsa, file_name);
 	mfree(file_name);
+	stat_add(ip, &run, STAT_WRITE, started);
 	
-	//Delete the nominal data and output names.
-	del_double_2d(num_dependent, nominal_output);
-	del_char_2d(num_dependent, output_names[0]);
-	delete[] output_names;
-	//Delete the sensitivity data. This could be returned to main() if it is needed for something else, but at this point it has been written to file and should no longer be needed.
-	del_double_2d(ip.dims, lsa);
+	//The sensitivity data is freed with the arena of run, together with the simulation results. It could be returned to main() if it is needed for something else, but at this point it has been written to file and should no longer be needed.
 	return;
 }
 
+/*	Fills in the rows of work->lsa for the dimensions from first up to (not including) last of work->run, with the non-dimensional sensitivity of every feature to each dimension, and their round errors in the same rows of work->round_errors.
+	It can be called from any thread, since it only reads the results of the set and writes nothing else (see threads.cpp).
+*/
+void differentiate_dims (void* context, int first, int last) {
+	lsa_work& work = *(lsa_work*)context;
+	nominal_run& run = *work.run;
+	int num_dependent = run.num_features;
+	//The output of the nominal set is what the other values will be compared against. nominal_output.at(j, 0) is the value of output feature j.
+	matrix& nominal_output = *run.nominal_output;
+	for(int i = first; i < last; i++){
+		// Fills LSA matrix with derivative values
+		double* sense = work.lsa->row(i);
+		//A parameter with a nominal value of 0 is not perturbed at all, so it has no effect on the features. See share_sets() in init.hpp.
+		if(run.constant[i]){
+			memset(sense, 0, sizeof(double)*num_dependent);
+			continue;
+		}
+		//A parameter whose job was killed at its deadline has no sensitivity. See deadline.cpp.
+		if(run.failed[i + 1]){
+			for(int j = 0; j < num_dependent; j++){
+				sense[j] = NAN;
+			}
+			continue;
+		}
+		fin_dif_one_dim(2 * run.rings[i], (run.nominal[i] * run.ss->step_per_set), *run.dim_output[i], sense, work.round_errors->row(i));
+		// Scale each sensitivity value to remove dimensionalization
+		for (int j = 0; j < num_dependent; j++){
+			sense[j] = non_dim_sense(run.nominal[i], nominal_output.at(j, 0), sense[j]); 
+		}
+	}
+}
+
 /*	Handles the call to the finite difference library which is simple to use.
-	In the case that the finite difference fills round_error with a value greater than the parameter perturbation size, this prints out a message but does not halt the program.
+	Its round errors are checked by check_round_errors(), which is left to the caller so that it can be called from any thread.
 	See finite_difference.cpp & .hpp
-	Note that the int accuracy is/should be equal to the length of each array within dependent_values -- i.e. it is equal to how many pertubation points were made by generate_data. 
+	dependent_values has a row for each output feature and a column for each perturbation, with COL_MAJOR layout. The derivatives of all features are calculated in one pass by fdy_fdx_all(), and the derivative of feature i is stored in fin_dif[i] and its round error in round_error[i].
+	Note that the int accuracy is/should be equal to the number of pertubation points that were simulated, which are the middle columns of dependent_values -- i.e. it is equal to how many pertubation points were made by sim_set unless the points were refined with --tolerance. 
 */
-double* fin_dif_one_dim (int accuracy, int num_dependent, double independent_step, double** dependent_values) {
-	double round_error = 0;
-	double* fin_dif = new double[num_dependent];
+void fin_dif_one_dim (int accuracy, double independent_step, matrix& dependent_values, double* fin_dif, double* round_error) {
+	int num_dependent = dependent_values.rows;
+	int first = (dependent_values.cols - accuracy) / 2;
+	//See the description of check_num() for a description of this check.
+	for(int j = first; j < first + accuracy; j++){
+		double* values = dependent_values.col(j);
+		for(int i = 0; i < num_dependent; i++){
+			values[i] = check_num(values[i]);
+		}
+	}
+	//Call the finite difference function to get the derivatives.
+	fdy_fdx_all(accuracy, num_dependent, independent_step, dependent_values.col(first), dependent_values.stride, fin_dif, round_error);
+}
 
+/*	In the case that the finite difference of a dimension (see fin_dif_one_dim()) filled round_error with a value greater than the parameter perturbation size, this prints out a message but does not halt the program.
+*/
+void check_round_errors (int num_dependent, double independent_step, double* round_error) {
 	for(int i = 0; i < num_dependent; i++){
-		//See the description of check_num() for a description of this check.
-		for(int j = 0; j < accuracy; j++){
-			dependent_values[i][j] = check_num(dependent_values[i][j]);
+		if(round_error[i] >= independent_step){
+			cout << "\tBad round error ("<< round_error[i] << ") for output: " << i << "\n";
 		}
-		//Call the finite difference function to get the derivative.
-		fdy_fdx( accuracy, independent_step, dependent_values[i], fin_dif + i, &round_error);
-		//Check the round error.
-		if(round_error >= independent_step){
-			cout << "\tBad round error ("<< round_error << ") for output: " << i << "\n";
+	}
+}
+
+
+/*	With --tolerance the perturbations of every dimension are simulated one ring at a time, starting with the pair closest to the nominal set, and this function is called once the results of each ring are in.
+	It calculates the finite differences from all rings so far and compares them with those from the rings before: the dimension has converged once no feature's finite difference changed by more than ip.tolerance times its size.
+	A dimension also stops at ip.points rings, or at the rings the most accurate stencil of finite-difference.hpp can use, since further rings would not change its finite differences.
+	Returns true if the dimension needs no more rings.
+*/
+bool dim_converged (input_params& ip, nominal_run& run, int dim) {
+	sim_set& ss = *run.ss;
+	int rings = run.rings[dim];
+	int features = run.num_features;
+	if(run.estimates == NULL){
+		//The last row holds the new finite differences while they are compared with the old ones.
+		run.estimates = arena_matrix(run.arena, ss.dims + 1, features, ROW_MAJOR);
+	}
+	matrix& y = *run.dim_output[dim];
+	double* estimate = run.estimates->row(dim);
+	double* latest = run.estimates->row(ss.dims);
+	fdy_fdx_all(2 * rings, features, (run.nominal[dim] * ss.step_per_set), y.col(ss.points - rings), y.stride, latest, NULL);
+	bool converged = (rings >= min(ss.points, ACC_MAX / 2));
+	if(rings > 1){
+		bool close = true;
+		for(int j = 0; j < features && close; j++){
+			if(latest[j] != estimate[j]){
+				close = (isinf(latest[j]) == 0 && isinf(estimate[j]) == 0 && fabs(latest[j] - estimate[j]) <= ip.tolerance * fmax(fabs(latest[j]), fabs(estimate[j])));
+			}
 		}
+		converged = converged || close;
 	}
-	return fin_dif;
+	memcpy(estimate, latest, sizeof(double) * features);
+	if(converged){
+		cout << "Parameter: " << dim << " converged after " << rings << " of " << ss.points << " points\n";
+	}
+	return converged;
 }
 
+/*	With --screen or --screen-top every dimension is first simulated with only the ring closest to the nominal set, and this function is called once the results of all of them (and of the nominal set) are in.
+	It normalizes the sensitivities from the second-order stencil of that ring (see normalize()), and every dimension whose normalized sensitivity to some feature is above ip.screen, or among the ip.screen_top largest of that feature, gets the rest of its rings, up to the most accurate stencil of finite-difference.hpp. The closest ring is kept, so only the outer rings are simulated. The other dimensions keep the second-order stencil of their closest ring.
+	Returns the number of dimensions that get more rings. The set is screened only once.
+*/
+int screen_dims (input_params& ip, nominal_run& run) {
+	sim_set& ss = *run.ss;
+	int features = run.num_features;
+	int rings = min(ss.points, ACC_MAX / 2);
+	run.screened = true;
+	if(rings <= 1 || run.failed[0] || run.nominal_output == NULL){
+		return 0;
+	}
+	matrix& shares = *arena_matrix(run.arena, ss.dims, features, ROW_MAJOR);
+	for(int i = 0; i < ss.dims; i++){
+		double* sense = shares.row(i);
+		//Parameters without a sensitivity have nothing to refine.
+		if(run.constant[i] || run.failed[i + 1] || run.dim_output[i] == NULL){
+			memset(sense, 0, sizeof(double) * features);
+			continue;
+		}
+		fin_dif_one_dim(2, (run.nominal[i] * ss.step_per_set), *run.dim_output[i], sense, NULL);
+		for(int j = 0; j < features; j++){
+			sense[j] = non_dim_sense(run.nominal[i], run.nominal_output->at(j, 0), sense[j]);
+		}
+	}
+	normalize(shares);
+	bool* refined = run.alloc<bool>(ss.dims);
+	memset(refined, 0, sizeof(bool) * ss.dims);
+	for(int j = 0; j < features; j++){
+		vec_view share = shares.col_view(j);
+		for(int i = 0; i < ss.dims; i++){
+			if(refined[i] || share[i] <= 0) continue;
+			//A dimension is among the top ones of the feature if fewer than screen_top dimensions have a larger share, so ties are all kept.
+			int larger = 0;
+			for(int k = 0; k < ss.dims && ip.screen_top > 0 && larger < ip.screen_top; k++){
+				larger += (share[k] > share[i]);
+			}
+			refined[i] = ((ip.screen > 0 && share[i] > ip.screen) || (ip.screen_top > 0 && larger < ip.screen_top));
+		}
+	}
+	//The queued dimensions are started from the last one, so the first dimension is queued last.
+	int count = 0;
+	for(int i = ss.dims - 1; i >= 0; i--){
+		if(refined[i] && !run.constant[i] && !run.failed[i + 1]){
+			run.add_rings(i, rings);
+			count++;
+		}
+	}
+	run.unfinished += count;
+	cout << "Screening refines " << count << " of " << ss.dims << " parameters to " << rings << " points\n";
+	return count;
+}
 
 /*	Calling this function performs a normalization by taking the sum of lsa values accross each parameter then then divides individual parameter sensitivity values by the sum and multiplies by 100 to give a percentage of total sensitivity.
-	The input double array is modified in place.
+	The input matrix (a row for each parameter, a column for each feature) is modified in place.
 */
-void normalize (int dims, int num_dependent, double** lsa_values) {
+void normalize (matrix& lsa_values) {
 	double sum = 1;
-	for( int i = 0; i < num_dependent; i++){
+	for( int i = 0; i < lsa_values.cols; i++){
+		vec_view sense = lsa_values.col_view(i);
 		sum = 0;
-		for( int j = 0; j < dims; j++){
+		for( int j = 0; j < sense.length; j++){
 			//Normalization deals only with the absolute value of sensitivity -- not the direction (+/-) of the influence. See the description of check_num also.
-			sum += check_num( abs(lsa_values[j][i]) );
+			sum += check_num( abs(sense[j]) );
 		}
-		for( int j = 0; j < dims; j++){
+		for( int j = 0; j < sense.length; j++){
 			if(sum != 0 && isinf(sum) == 0){
 				//This calulates the percentage of the total sensitivity for each parameter by multiplying by 100 and dividing by the sum of all sensitivity.
-				lsa_values[j][i] =  ( check_num( abs(lsa_values[j][i]) ) *(double)100 ) / sum;
+				sense[j] =  ( check_num( abs(sense[j]) ) *(double)100 ) / sum;
 			}
 		}
 	}
 }
 
 //Methods for deleting arrays.
-void del_double_2d (int rows, double** victim) {
-	for(int i = 0; i < rows; i++){
-		delete[] victim[i];
-	}
-	delete[] victim;
-}
 
 void del_char_2d (int rows, char** victim) {
 	for(int i = 0; i < rows; i++){
@@ -230,15 +336,34 @@ void usage (const char* message, int error) {
 	cout << "-D, --data-dir       [filename]   : the relative name of the directory to which the raw simulation data will be stored, default=sim-data" << endl;
 	cout << "-p, --percentage     [float]      : the maximum percentage by which nominal values will be perturbed (+/-), min=0, max=100, default=5" << endl;
 	cout << "-P, --points         [int]        : the number of data points to collect on either side (+/-) of the nominal set, min=1, default=10" << endl;
+	cout << "-t, --tolerance      [float]      : simulate the points one pair at a time, from the nominal set outwards, until the sensitivities change by less than this fraction, 0 to simulate every point, min=0, default=0" << endl;
+	cout << "-x, --screen         [float]      : simulate only the closest points first, and the rest of the points only for the parameters whose normalized sensitivity to some feature is above this percentage, min=0, max=100, default=unused" << endl;
+	cout << "-X, --screen-top     [int]        : like --screen, but the rest of the points are simulated for the parameters with one of this many largest normalized sensitivities of any feature, min=1, default=unused" << endl;
+	cout << "-M, --method         [lsa|morris] : calculate local sensitivities, or screen the parameters with Morris elementary effects (mu_star, mu and sigma files), default=lsa" << endl;
+	cout << "-R, --trajectories   [int]        : the number of one-at-a-time trajectories per nominal set of --method morris, min=1, default=10" << endl;
+	cout << "-V, --levels         [int]        : the number of grid levels of --method morris, an even number, min=2, default=4" << endl;
+	cout << "-C, --cache-dir      [directory]  : reuse the results of parameter sets that were simulated before (with the same simulation, --sim-args and --random-seed) from this cache directory, which can be shared by runs at the same time, default=unused" << endl;
 	cout << "-c, --nominal-count  [int]        : the number of nominal sets to read from the file, min=1, default=1" << endl;
 	cout << "-k, --skip           [int]        : the number of lines in the nominal sets file to skip over (excluding comments), min=0, default=0" << endl;
 	cout << "-s, --random-seed    [int]        : the seed to generate random numbers, min=1, default=generated from the time and process ID" << endl;
-	cout << "-l, --processes      [int]        : the number of processes to which parameter sets can be sent for parallel data collection, min=1, default=2" << endl;
+	cout << "-S, --stats          [filename]   : write the time spent in every phase of the run, per nominal set and for the whole run, and the simulation throughput and core utilization to this JSON file, default=unused" << endl;
+	cout << "-l, --processes      [int|auto]   : the number of processes to which parameter sets can be sent for parallel data collection, or auto to use the CPUs and memory that are available, min=1, default=2" << endl;
+	cout << "-A, --analysis-threads [int|auto] : the number of threads that calculate the finite differences of each nominal set, or auto for one per usable CPU, min=1, default=1" << endl;
+	cout << "-j, --dims-per-job   [int|auto]   : the number of dimensions whose perturbed sets one simulation runs, or auto to choose it from the measured startup and per-set time of the simulation, min=1, default=1" << endl;
+	cout << "-J, --sets-per-job   [int]        : split the perturbed sets of a dimension among several simulations of at most this many sets each, min=1, default=unused" << endl;
+	cout << "-r, --resume         [N/A]        : continue the run whose --data-dir is given, skipping the sets and simulations it finished, default=unused" << endl;
+	cout << "-T, --deadline       [float[x]]   : the time a simulation may take per parameter set, in seconds or followed by x as a multiple of the median time, after which it is copied to an idle process, default=unused" << endl;
+	cout << "-K, --kill-late      [N/A]        : kill the simulations that pass --deadline instead, leaving nan sensitivities for their parameters, default=unused" << endl;
 	cout << "-y, --recycle        [N/A]        : include this if the simulation output has already been generated for exactly the same configuration used now, default=unused" << endl;
+	cout << "-b, --binary-results [N/A]        : have the simulations send their results back through the pipe instead of reading the features files, default=unused" << endl;
+	cout << "-m, --memory-data    [N/A]        : keep the simulation data in in-memory files instead of the data directory, which implies --delete-data, default=unused" << endl;
+	cout << "-w, --persistent     [N/A]        : start the simulation processes once and stream every job to them, the simulation must support --stream-jobs, default=unused" << endl;
+	cout << "-L, --listen         [int]        : be the coordinator of a run spread over several machines, sending every job to workers that connect to this port, default=unused" << endl;
+	cout << "-W, --worker         [host:port]  : be a worker of the coordinator at host:port, simulating its jobs with --exec on this machine, default=unused" << endl;
 	cout << "-g, --generate-only  [N/A]        : generate oscillations features files for perturbed parameter values without calculating sensitivity, default=unused" << endl;
 	cout << "-z, --delete-data    [N/A]        : delete oscillation features data, specified by -D or --data-dir, when the program exits, default=unused" << endl;
 	cout << "-q, --quiet          [N/A]        : hide the terminal output, default=unused" << endl;
-	cout << "-e, --exec           [directory]  : the relative directory of the simulation executable, default=../simulation/" << endl;
+	cout << "-e, --exec           [directory]  : the relative directory of the simulation executable, or a simulation plugin ending in .so, default=../simulation/" << endl;
 	cout << "-a, --sim-args       [N/A]        : arguments following this will be sent to the deterministic simulation" << endl;
 	cout << "-l, --licensing      [N/A]        : view licensing information (no simulations will be run)" << endl;
 	cout << "-h, --help           [N/A]        : view usage information (i.e. this)" << endl;
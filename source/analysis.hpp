@@ -25,11 +25,20 @@ analysis.hpp contains function declarations for analysis.cpp.
 
 #include "init.hpp"
 
-void generate_data(input_params&, sim_set&);
-void LSA_all_dims(input_params&, sim_set&);
-double* fin_dif_one_dim(int, int, double, double**);
-void normalize(int, int, double**);
-void del_double_2d(int, double**);
+//Struct for the finite differences of one nominal set that differentiate_dims() shares out among the analysis threads.
+struct lsa_work{
+	nominal_run* run;
+	matrix* lsa; //The sensitivities, a dims x features matrix.
+	matrix* round_errors; //The round errors of the finite differences, a dims x features matrix.
+};
+
+void LSA_all_dims(input_params&, nominal_run&);
+void differentiate_dims(void* , int , int );
+void fin_dif_one_dim(int, double, matrix&, double*, double*);
+void check_round_errors(int, double, double*);
+void normalize(matrix&);
+bool dim_converged(input_params&, nominal_run&, int);
+int screen_dims(input_params&, nominal_run&);
 void del_char_2d(int, char**);
 void licensing();
 void usage(const char*, int);
@@ -0,0 +1,365 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+cache.cpp contains the cache of simulation results that can be shared by any number of runs, including runs that are going on at the same time.
+*/
+
+#include "cache.hpp" // Function declarations
+
+#include "io.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	The cache holds the output features of single parameter sets, so a run only simulates the sets that no earlier run (with the same simulation, arguments and seed) has simulated, whatever the nominal sets, --percentage or --points were.
+	Every set is stored in its own entry file, named by the hash of ip.cache_key and the exact parameter values. The entry repeats the key and the parameter values and ends with a checksum, so an entry is only used if it really is for the same set and was written completely.
+	Entries are written and read while holding an flock() on them, exclusive for writing and shared for reading, so several runs can use one cache directory at once. The names of the output features are kept once per cache key in the same way.
+*/
+
+/*	Makes the cache directory and sets ip.cache_key.
+*/
+void open_cache (input_params& ip) {
+	make_dir(ip.cache_dir);
+	ip.cache_key = simulation_key(ip);
+}
+
+/*	Returns the hash of everything besides the parameter values that the simulation results depend on: the simulation program, the arguments given to it with --sim-args and the random seed.
+	The arguments of the optional protocol extensions (e.g. --binary-results) only change how the results are sent, so they are left out.
+*/
+uint64_t simulation_key (input_params& ip) {
+	uint64_t key = hash_bytes(CACHE_HASH_START, CACHE_VERSION, strlen(CACHE_VERSION));
+	//The same program can be named by different paths.
+	char* exec_path = realpath(ip.sim_exec, NULL);
+	const char* exec = (exec_path != NULL ? exec_path : ip.sim_exec);
+	key = hash_bytes(key, exec, strlen(exec) + 1);
+	if(exec_path != NULL) free(exec_path);
+	for(int i = 9 + ip.protocol_args; i < ip.sim_args_num && ip.simulation_args[i] != NULL; i++){
+		key = hash_bytes(key, ip.simulation_args[i], strlen(ip.simulation_args[i]) + 1);
+	}
+	return hash_bytes(key, &ip.random_seed, sizeof(int));
+}
+
+//Adds length bytes to the 64 bit FNV-1a hash hash and returns the new hash.
+uint64_t hash_bytes (uint64_t hash, const void* bytes, size_t length) {
+	const unsigned char* next = (const unsigned char*)bytes;
+	for(size_t i = 0; i < length; i++){
+		hash ^= next[i];
+		hash *= CACHE_HASH_PRIME;
+	}
+	return hash;
+}
+
+//Returns the key of the cache entry of the parameter set params.
+uint64_t set_key (input_params& ip, double* params) {
+	return hash_bytes(ip.cache_key, params, sizeof(double)*ip.dims);
+}
+
+/*	Returns the (mallocated) name of the cache file with the given key. Entries are spread over 256 subdirectories named by the first byte of their key, which are made if make is true.
+	The names of the output features are kept in "names_" followed by ip.cache_key.
+*/
+char* entry_name (input_params& ip, uint64_t key, bool make) {
+	char* name = (char*)mallocate(sizeof(char)*(strlen(ip.cache_dir) + 32));
+	if(key == ip.cache_key){
+		sprintf(name, "%s/names_%016llx", ip.cache_dir, (unsigned long long)key);
+		return name;
+	}
+	sprintf(name, "%s/%02x", ip.cache_dir, (unsigned int)(key >> 56));
+	if(make && -1 == mkdir(name, S_IRWXU) && errno != EEXIST){
+		mfree(name);
+		return NULL;
+	}
+	sprintf(name + strlen(name), "/%014llx", (unsigned long long)(key & 0xffffffffffffffULL));
+	return name;
+}
+
+//Reads exactly length bytes from fd into destination. Returns false if there are not that many.
+bool read_entry (int fd, void* destination, size_t length) {
+	char* into = (char*)destination;
+	while(length > 0){
+		ssize_t got = read(fd, into, length);
+		if(got == -1 && errno == EINTR) continue;
+		if(got <= 0) return false;
+		into += got;
+		length -= got;
+	}
+	return true;
+}
+
+/*	Looks up the parameter set params in the cache.
+	Returns the number of output features, which are stored in values (which must have room for MAX_NUM_FEATS), or -1 if the set is not in the cache.
+*/
+int cache_fetch (input_params& ip, double* params, double* values) {
+	char* name = entry_name(ip, set_key(ip, params), false);
+	int fd = open(name, O_RDONLY);
+	mfree(name);
+	if(fd == -1){
+		return -1;
+	}
+	flock(fd, LOCK_SH);
+	int features = check_entry(ip, fd, params, values);
+	flock(fd, LOCK_UN);
+	close(fd);
+	return features;
+}
+
+/*	Reads the cache entry open in fd, which has to be locked, from its start. An entry looks like:
+		[uint64_t CACHE_MAGIC][uint64_t ip.cache_key][int dims][int features][dims doubles: the parameter values][features doubles: the output features][uint64_t hash of all the bytes before it]
+	Returns the number of output features, which are stored in values unless it is NULL, or -1 if the entry is not a complete entry for the parameter set params.
+*/
+int check_entry (input_params& ip, int fd, double* params, double* values) {
+	uint64_t head[2];
+	int counts[2];
+	if(lseek(fd, 0, SEEK_SET) != 0 || !read_entry(fd, head, sizeof(head)) || !read_entry(fd, counts, sizeof(counts))){
+		return -1;
+	}
+	if(head[0] != CACHE_MAGIC || head[1] != ip.cache_key || counts[0] != ip.dims || counts[1] < 0 || counts[1] > MAX_NUM_FEATS){
+		return -1;
+	}
+	int features = -1;
+	size_t length = sizeof(double)*(counts[0] + counts[1]);
+	double* body = new double[counts[0] + counts[1]];
+	uint64_t checksum = 0;
+	if(read_entry(fd, body, length) && read_entry(fd, &checksum, sizeof(checksum)) && memcmp(body, params, sizeof(double)*ip.dims) == 0){
+		uint64_t hash = hash_bytes(CACHE_HASH_START, head, sizeof(head));
+		hash = hash_bytes(hash, counts, sizeof(counts));
+		if(checksum == hash_bytes(hash, body, length)){
+			features = counts[1];
+			if(values != NULL){
+				memcpy(values, body + counts[0], sizeof(double)*features);
+			}
+		}
+	}
+	delete[] body;
+	return features;
+}
+
+/*	Stores the features output features in values of the parameter set params in the cache, unless another run has already stored them. See check_entry() for the layout of an entry.
+	Failing to write to the cache only means the set will have to be simulated again, so it is not an error.
+*/
+void cache_store (input_params& ip, double* params, double* values, int features) {
+	uint64_t head[2] = {CACHE_MAGIC, ip.cache_key};
+	int counts[2] = {ip.dims, features};
+	size_t length = sizeof(head) + sizeof(counts) + sizeof(double)*(ip.dims + features) + sizeof(uint64_t);
+	char* name = entry_name(ip, set_key(ip, params), true);
+	if(name == NULL) return;
+	int fd = open(name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	mfree(name);
+	if(fd == -1) return;
+	flock(fd, LOCK_EX);
+	//A file that is not a complete entry was left by a run that failed while writing it, or has been damaged since, and is written again.
+	if(check_entry(ip, fd, params, NULL) != features){
+		char* entry = new char[length];
+		char* pos = entry;
+		memcpy(pos, head, sizeof(head));
+		pos += sizeof(head);
+		memcpy(pos, counts, sizeof(counts));
+		pos += sizeof(counts);
+		memcpy(pos, params, sizeof(double)*ip.dims);
+		pos += sizeof(double)*ip.dims;
+		memcpy(pos, values, sizeof(double)*features);
+		pos += sizeof(double)*features;
+		uint64_t checksum = hash_bytes(CACHE_HASH_START, entry, pos - entry);
+		memcpy(pos, &checksum, sizeof(checksum));
+		if(ftruncate(fd, 0) == 0){
+			pwrite(fd, entry, length, 0);
+		}
+		delete[] entry;
+	}
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+/*	Reads the names of the output features for ip.cache_key from the cache, which are needed whenever the results of a nominal set come from the cache.
+	Returns the names (in an array like load_output() makes), or NULL if there are no names for exactly features features.
+*/
+char** cache_fetch_names (input_params& ip, int features) {
+	char* name = entry_name(ip, ip.cache_key, false);
+	int fd = open(name, O_RDONLY);
+	mfree(name);
+	if(fd == -1){
+		return NULL;
+	}
+	flock(fd, LOCK_SH);
+	char** names = check_names(ip, fd, features);
+	flock(fd, LOCK_UN);
+	close(fd);
+	return names;
+}
+
+/*	Reads the names file open in fd, which has to be locked. The names file looks like:
+		[uint64_t CACHE_MAGIC][uint64_t ip.cache_key][int features][for every feature: int length, then the name without a terminating '\0'][uint64_t hash of all the bytes before it]
+	Returns the names as cache_fetch_names() does, or NULL if the file is not complete or not for exactly features features.
+*/
+char** check_names (input_params& ip, int fd, int features) {
+	struct stat info;
+	if(fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(uint64_t)*3 + sizeof(int) || lseek(fd, 0, SEEK_SET) != 0){
+		return NULL;
+	}
+	size_t length = info.st_size - sizeof(uint64_t);
+	char* entry = new char[length];
+	uint64_t checksum = 0;
+	uint64_t head[2] = {0, 0};
+	int count = -1;
+	if(read_entry(fd, entry, length) && read_entry(fd, &checksum, sizeof(checksum)) && checksum == hash_bytes(CACHE_HASH_START, entry, length)){
+		memcpy(head, entry, sizeof(head));
+		memcpy(&count, entry + sizeof(head), sizeof(int));
+	}
+	char** names = NULL;
+	if(count == features && head[0] == CACHE_MAGIC && head[1] == ip.cache_key){
+		names = new char*[MAX_NUM_FEATS];
+		size_t pos = sizeof(head) + sizeof(int);
+		for(int j = 0; j < features; j++){
+			int name_length = 0;
+			if(pos + sizeof(int) <= length){
+				memcpy(&name_length, entry + pos, sizeof(int));
+				pos += sizeof(int);
+			}
+			if(name_length < 0 || pos + name_length > length){
+				name_length = 0;
+			}
+			names[j] = new char[name_length + 1];
+			memcpy(names[j], entry + pos, name_length);
+			names[j][name_length] = '\0';
+			pos += name_length;
+		}
+	}
+	delete[] entry;
+	return names;
+}
+
+/*	Stores the names of the output features for ip.cache_key in the cache, unless they are already there. See check_names() for the layout.
+*/
+void cache_store_names (input_params& ip, char** names, int features) {
+	size_t length = sizeof(uint64_t)*2 + sizeof(int);
+	for(int j = 0; j < features; j++){
+		length += sizeof(int) + strlen(names[j]);
+	}
+	char* name = entry_name(ip, ip.cache_key, true);
+	int fd = open(name, O_RDWR | O_CREAT, S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+	mfree(name);
+	if(fd == -1) return;
+	flock(fd, LOCK_EX);
+	char** stored = check_names(ip, fd, features);
+	if(stored != NULL){
+		for(int j = 0; j < features; j++){
+			delete[] stored[j];
+		}
+		delete[] stored;
+	} else{
+		char* entry = new char[length + sizeof(uint64_t)];
+		uint64_t head[2] = {CACHE_MAGIC, ip.cache_key};
+		memcpy(entry, head, sizeof(head));
+		memcpy(entry + sizeof(head), &features, sizeof(int));
+		size_t pos = sizeof(head) + sizeof(int);
+		for(int j = 0; j < features; j++){
+			int name_length = strlen(names[j]);
+			memcpy(entry + pos, &name_length, sizeof(int));
+			pos += sizeof(int);
+			memcpy(entry + pos, names[j], name_length);
+			pos += name_length;
+		}
+		uint64_t checksum = hash_bytes(CACHE_HASH_START, entry, length);
+		memcpy(entry + length, &checksum, sizeof(checksum));
+		if(ftruncate(fd, 0) == 0){
+			pwrite(fd, entry, length + sizeof(uint64_t), 0);
+		}
+		delete[] entry;
+	}
+	flock(fd, LOCK_UN);
+	close(fd);
+}
+
+/*	Fills in the sets of job dim of run (as chosen by plan_job() in io.cpp) that are in the cache, and leaves only the other sets in the job.
+	The results of the nominal set are only taken from the cache if the names of the output features are there too. A set whose number of features does not match the results the nominal set already has is simulated again.
+	Returns true if every set of the job was in the cache.
+*/
+bool lookup_job (input_params& ip, nominal_run& run, int dim) {
+	double values[MAX_NUM_FEATS];
+	if(dim == JOB_NOMINAL){
+		int features = cache_fetch(ip, run.nominal, values);
+		if(features < 0 || (run.num_features != -1 && features != run.num_features)){
+			return false;
+		}
+		char** names = cache_fetch_names(ip, features);
+		if(names == NULL){
+			return false;
+		}
+		run.num_features = features;
+		run.output_names = arena_names(run.arena, names, features);
+		for(int j = 0; j < features; j++){
+			delete[] names[j];
+		}
+		delete[] names;
+		run.nominal_output = arena_matrix(run.arena, features, 1, COL_MAJOR);
+		memcpy(run.nominal_output->col(0), values, sizeof(double)*features);
+		run.job_count[0] = 0;
+		return true;
+	}
+	double* params = new double[run.ss->dims];
+	int* columns = run.job_columns(dim);
+	int kept = 0;
+	for(int i = 0; i < run.job_count[dim + 1]; i++){
+		job_set(run, dim, columns[i], params);
+		int features = cache_fetch(ip, params, values);
+		if(features < 0 || (run.num_features != -1 && features != run.num_features)){
+			columns[kept++] = columns[i];
+			continue;
+		}
+		run.num_features = features;
+		if(run.dim_output[dim] == NULL){
+			run.dim_output[dim] = arena_matrix(run.arena, features, run.ss->sets_per_dim, COL_MAJOR);
+		}
+		memcpy(run.dim_output[dim]->col(columns[i]), values, sizeof(double)*features);
+	}
+	delete[] params;
+	run.job_count[dim + 1] = kept;
+	return kept == 0;
+}
+
+/*	Stores the results of the sets job dim of run simulated in the cache, once they have been collected.
+*/
+void cache_job (input_params& ip, nominal_run& run, int dim) {
+	if(dim == JOB_NOMINAL){
+		if(run.job_count[0] == 1 && run.nominal_output != NULL){
+			cache_store(ip, run.nominal, run.nominal_output->col(0), run.num_features);
+			cache_store_names(ip, run.output_names, run.num_features);
+		}
+		return;
+	}
+	if(run.dim_output[dim] == NULL){
+		return;
+	}
+	double* params = new double[run.ss->dims];
+	int* columns = run.job_columns(dim);
+	for(int i = 0; i < run.job_count[dim + 1]; i++){
+		job_set(run, dim, columns[i], params);
+		cache_store(ip, params, run.dim_output[dim]->col(columns[i]), run.num_features);
+	}
+	delete[] params;
+}
+
+//Fills params with the parameter set in column column of dimension dim of run, i.e. the nominal set with the perturbed value of dimension dim, or with set column of trajectory dim with --method morris.
+void job_set (nominal_run& run, int dim, int column, double* params) {
+	if(run.ss->trajectories != NULL){
+		memcpy(params, run.ss->trajectories->row(dim * run.ss->sets_per_dim + column), sizeof(double)*run.ss->dims);
+		return;
+	}
+	memcpy(params, run.nominal, sizeof(double)*run.ss->dims);
+	params[dim] = run.ss->dim_sets->row(dim)[column];
+}
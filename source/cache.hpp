@@ -0,0 +1,47 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+cache.hpp contains function declarations for cache.cpp.
+*/
+
+#ifndef CACHE_HPP
+#define CACHE_HPP
+
+#include <sys/file.h>	//(flock for sharing the cache directory between several runs.)
+#include <stdint.h>		//(The 64 bit hashes that name the cache entries.)
+
+#include "init.hpp"
+
+void open_cache(input_params& );
+uint64_t simulation_key(input_params& );
+uint64_t hash_bytes(uint64_t , const void* , size_t );
+uint64_t set_key(input_params& , double* );
+char* entry_name(input_params& , uint64_t , bool );
+bool read_entry(int , void* , size_t );
+int cache_fetch(input_params& , double* , double* );
+int check_entry(input_params& , int , double* , double* );
+void cache_store(input_params& , double* , double* , int );
+char** cache_fetch_names(input_params& , int );
+char** check_names(input_params& , int , int );
+void cache_store_names(input_params& , char** , int );
+bool lookup_job(input_params& , nominal_run& , int );
+void cache_job(input_params& , nominal_run& , int );
+void job_set(nominal_run& , int , int , double* );
+
+#endif
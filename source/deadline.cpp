@@ -0,0 +1,314 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+deadline.cpp contains the deadlines of simulation jobs and what is done with the jobs that pass them.
+*/
+
+#include "deadline.hpp" // Function declarations
+
+#include "plugin.hpp"
+#include "remote.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	With --deadline every simulation job has a deadline, so that a parameter set that makes the simulation take far longer than the others (e.g. because it makes the equations stiff) cannot stall the whole run.
+	The deadline of a job is the given time per parameter set times the number of sets the job simulates. The time is either in seconds or a multiple of the median time per set of the jobs that have finished so far, which only applies once DEADLINE_MIN_JOBS jobs have finished and is never shorter than DEADLINE_MIN_TIME seconds per job.
+	A job that passes its deadline is late. A late job is copied to the next idle slot, and whichever of the two finishes first is used while the other is stopped. A copy writes its own features file (the job's file followed by ".copy", or its own in-memory file), which takes the place of the job's file if the copy finishes first.
+	With --kill-late a late job is killed instead and its sets are marked as failed (see nominal_run.failed in init.hpp), so the run goes on without them.
+	The threads of a simulation plugin cannot be stopped, so a plugin job that is stopped keeps its slot until it returns and its results are thrown away. A remote worker whose job is stopped is disconnected, and connects again once its simulation is done.
+*/
+
+//Returns the time of the monotonic clock, in seconds.
+double now_seconds () {
+	struct timespec now;
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return now.tv_sec + now.tv_nsec * 1e-9;
+}
+
+/*	Returns how long the job running on slot may take before it is late, in seconds, or 0 if it has no deadline (yet).
+*/
+double job_limit (input_params& ip, sim_slot& slot) {
+	int sets = slot.sets;
+	if(!ip.relative_deadline){
+		return ip.deadline * sets;
+	}
+	if(ip.pool->num_times < DEADLINE_MIN_JOBS){
+		return 0;
+	}
+	return fmax(ip.deadline * ip.pool->median_time * sets, DEADLINE_MIN_TIME);
+}
+
+/*	Returns the number of milliseconds until the next running job becomes late, which is how long the pool can be waited on before check_deadlines() has to be called again, or -1 if no running job has a deadline.
+*/
+int deadline_timeout (input_params& ip) {
+	if(ip.deadline == 0 || ip.pool->stopping){
+		return -1;
+	}
+	double now = now_seconds();
+	double next = -1;
+	for(int i = 0; i < ip.pool->count; i++){
+		sim_slot& slot = ip.pool->slot[i];
+		if(slot.job == SLOT_IDLE || slot.late || slot.cancelled) continue;
+		double limit = job_limit(ip, slot);
+		if(limit == 0) continue;
+		double left = fmax(slot.started + limit - now, 0);
+		if(next == -1 || left < next){
+			next = left;
+		}
+	}
+	if(next == -1){
+		return -1;
+	}
+	return (int)fmin(next * 1000 + 1, 1e9);
+}
+
+/*	Blocks SIGCHLD if block is true, otherwise unblocks it. With deadlines single simulations are waited for with sigtimedwait() (see wait_child() in io.cpp), which needs SIGCHLD to be blocked, and the simulations are started with it unblocked again.
+*/
+void block_children (bool block) {
+	sigset_t children;
+	sigemptyset(&children);
+	sigaddset(&children, SIGCHLD);
+	sigprocmask(block ? SIG_BLOCK : SIG_UNBLOCK, &children, NULL);
+}
+
+/*	Adds the time per parameter set of the job on slot, which took elapsed seconds, to the times the median is taken from.
+*/
+void record_time (input_params& ip, sim_slot& slot, double elapsed) {
+	sim_pool& pool = *ip.pool;
+	int sets = slot.sets;
+	if(sets == 0){
+		return;
+	}
+	if(pool.num_times == pool.times_size){
+		pool.times_size = (pool.times_size == 0 ? 64 : 2 * pool.times_size);
+		double* grown = new double[pool.times_size];
+		if(pool.set_times != NULL){
+			memcpy(grown, pool.set_times, sizeof(double)*pool.num_times);
+			delete[] pool.set_times;
+		}
+		pool.set_times = grown;
+	}
+	//The times are kept sorted, so the median is always the middle one.
+	double time = elapsed / sets;
+	int at = pool.num_times;
+	while(at > 0 && pool.set_times[at - 1] > time){
+		at--;
+	}
+	memmove(pool.set_times + at + 1, pool.set_times + at, sizeof(double)*(pool.num_times - at));
+	pool.set_times[at] = time;
+	pool.num_times++;
+	pool.median_time = pool.set_times[pool.num_times / 2];
+}
+
+/*	Finds the running jobs that have passed their deadline. A late job is killed with --kill-late, otherwise it is copied to an idle slot as soon as there is one.
+	This is called by the scheduler (see schedule.cpp) before it starts new jobs, so copies of late jobs go first.
+*/
+void check_deadlines (input_params& ip) {
+	if(ip.pool == NULL || ip.deadline == 0){
+		return;
+	}
+	sim_pool& pool = *ip.pool;
+	double now = now_seconds();
+	for(int i = 0; i < pool.count && ip.failure == NULL; i++){
+		sim_slot& slot = pool.slot[i];
+		if(slot.job == SLOT_IDLE || slot.cancelled) continue;
+		if(!slot.late){
+			double limit = job_limit(ip, slot);
+			if(limit == 0 || now - slot.started < limit) continue;
+			slot.late = true;
+			pool.late_jobs++;
+			cout << "Set: " << slot.run->index << " -- the job of ";
+			print_job(*slot.run, slot.job, slot.span);
+			cout << " is late after " << now - slot.started << " s\n";
+			if(ip.kill_late){
+				kill_job(ip, i);
+				continue;
+			}
+		}
+		//A late job gets one copy, and a copy is not copied again.
+		if(!ip.kill_late && slot.twin == -1 && !slot.copy && idle_slot(ip) != -1){
+			start_copy(ip, i);
+		}
+	}
+}
+
+/*	Starts a copy of the late job running on slot i on an idle slot.
+*/
+void start_copy (input_params& ip, int i) {
+	sim_pool& pool = *ip.pool;
+	sim_slot& original = pool.slot[i];
+	//simulate_job() starts the job on the first idle slot, which is the one marked as the copy.
+	int j = idle_slot(ip);
+	pool.slot[j].copy = true;
+	sim_job job = slot_job(original);
+	if(!simulate_job(ip, job)){
+		pool.slot[j].copy = false;
+		return;
+	}
+	pool.slot[j].twin = i;
+	original.twin = j;
+	pool.copies++;
+}
+
+/*	Kills the late job running on slot i and marks its sets as failed. The job is finished without results, so the run goes on without it.
+	Every dimension of the job fails, and a split dimension fails once the job was one of its pieces, but is only finished once its other pieces have finished too.
+*/
+void kill_job (input_params& ip, int i) {
+	sim_pool& pool = *ip.pool;
+	sim_slot& slot = pool.slot[i];
+	nominal_run& run = *slot.run;
+	int dim = slot.job;
+	int span = slot.span;
+	pool.slowest = fmax(pool.slowest, now_seconds() - slot.started);
+	cancel_job(ip, i);
+	for(int d = dim; d < dim + span; d++){
+		run.failed[d + 1] = true;
+		if(--run.pieces[d + 1] == 0){
+			run.unfinished--;
+		}
+	}
+	pool.killed_jobs++;
+	cout << "Set: " << run.index << " -- the late job was killed, so ";
+	if(dim == JOB_NOMINAL){
+		cout << "the set has no results\n";
+		return;
+	}
+	print_job(run, dim, span);
+	if(run.ss->trajectories != NULL){
+		cout << (span > 1 ? " are" : " is") << " left out of the screening\n";
+	} else{
+		cout << (span > 1 ? " have" : " has") << " no sensitivity\n";
+	}
+}
+
+//Writes what the job of span dimensions from dim on of run is to cout: the nominal set, parameters, or trajectories with --method morris.
+void print_job (nominal_run& run, int dim, int span) {
+	const char* kind = (run.ss->trajectories != NULL ? "trajector" : "parameter");
+	if(dim == JOB_NOMINAL){
+		cout << "the nominal set";
+	} else if(span > 1){
+		cout << kind << (run.ss->trajectories != NULL ? "ies " : "s ") << dim << " to " << dim + span - 1;
+	} else{
+		cout << kind << (run.ss->trajectories != NULL ? "y " : " ") << dim;
+	}
+}
+
+/*	Stops the job running on slot i and frees the slot without the job's results. A persistent worker is killed with its job and started again.
+*/
+void cancel_job (input_params& ip, int i) {
+	sim_pool& pool = *ip.pool;
+	sim_slot& slot = pool.slot[i];
+	//The features file of a stopped job is never used, except the job's own file once its copy finishes first.
+	if(slot.memfd != -1){
+		close(slot.memfd);
+		slot.memfd = -1;
+	} else if(slot.copy && !ip.memory_data && pool.plugin == NULL && !pool.remote){
+		char* file_name = slot_file(ip, slot, 0);
+		unmake_file(file_name, true);
+		mfree(file_name);
+	}
+	slot.late = false;
+	slot.copy = false;
+	slot.twin = -1;
+	slot.received_len = 0;
+	if(pool.plugin != NULL){
+		slot.cancelled = true;
+		return;
+	}
+	if(pool.remote){
+		slot.run = NULL;
+		slot.job = SLOT_IDLE;
+		drop_worker(ip, i);
+		return;
+	}
+	int status = 0;
+	kill(slot.pid, SIGKILL);
+	waitpid(slot.pid, &status, 0);
+	if(pool.persistent){
+		close(slot.job_fd);
+		close(slot.result_fd);
+		slot.job_fd = -1;
+	} else{
+		if(slot.result_fd != -1) close(slot.result_fd);
+		del_pipes(1, &slot.pipes, true);
+		slot.pipes = NULL;
+	}
+	slot.result_fd = -1;
+	del_arg(slot.args);
+	slot.args = NULL;
+	slot.pid = 0;
+	slot.run = NULL;
+	slot.job = SLOT_IDLE;
+	if(pool.persistent){
+		start_worker(ip, i);
+	}
+}
+
+/*	Called by wait_job() (see io.cpp) for the slot i whose job has just finished: records how long the job took and, if the job was copied, stops the other copy. A copy that finished first takes the place of the job it copied.
+*/
+void job_finished (input_params& ip, int i) {
+	sim_pool& pool = *ip.pool;
+	sim_slot& slot = pool.slot[i];
+	if(ip.deadline == 0){
+		return;
+	}
+	double elapsed = now_seconds() - slot.started;
+	pool.slowest = fmax(pool.slowest, elapsed);
+	if(ip.failure == NULL){
+		record_time(ip, slot, elapsed);
+	}
+	if(slot.twin != -1){
+		int twin = slot.twin;
+		pool.slot[twin].twin = -1;
+		slot.twin = -1;
+		cancel_job(ip, twin);
+	}
+	if(slot.copy){
+		pool.copies_won++;
+		adopt_copy(ip, slot);
+	}
+	slot.late = false;
+	slot.copy = false;
+}
+
+/*	Makes the features file of the copy running on slot the features file of its job, where collect_job() (see io.cpp) reads it from. An in-memory file already goes with the slot to the job that finished.
+*/
+void adopt_copy (input_params& ip, sim_slot& slot) {
+	if(!ip.memory_data && ip.pool->plugin == NULL && !ip.pool->remote){
+		sim_job job = slot_job(slot);
+		char* copy_name = slot_file(ip, slot, 0);
+		char* file_name = job_file(ip, job);
+		//With --binary-results the simulation does not have to write a features file at all.
+		rename(copy_name, file_name);
+		mfree(copy_name);
+		mfree(file_name);
+	}
+}
+
+/*	Prints how many jobs passed their deadline and what was done with them, at the end of a run with --deadline.
+*/
+void print_stragglers (input_params& ip) {
+	if(ip.deadline == 0){
+		return;
+	}
+	sim_pool& pool = *ip.pool;
+	cout << "\n ~ Deadlines: " << pool.late_jobs << " late jobs, " << pool.copies << " copies started (" << pool.copies_won << " finished first), " << pool.killed_jobs << " jobs killed ~ \n";
+	cout << " ~ Median time per parameter set: " << pool.median_time << " s, slowest job: " << pool.slowest << " s ~ \n";
+}
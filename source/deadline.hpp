@@ -0,0 +1,49 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+deadline.hpp contains function declarations for deadline.cpp.
+*/
+
+#ifndef DEADLINE_HPP
+#define DEADLINE_HPP
+
+#include <time.h>		//(The monotonic clock the jobs are timed with.)
+#include <signal.h>		//(Waiting for simulation children with a timeout.)
+
+#include "init.hpp"
+#include "io.hpp"
+
+//Timing functions:
+double now_seconds();
+double job_limit(input_params& , sim_slot& );
+int deadline_timeout(input_params& );
+void block_children(bool );
+void record_time(input_params& , sim_slot& , double );
+
+//Late job functions:
+void check_deadlines(input_params& );
+void start_copy(input_params& , int );
+void kill_job(input_params& , int );
+void print_job(nominal_run& , int , int );
+void cancel_job(input_params& , int );
+void job_finished(input_params& , int );
+void adopt_copy(input_params& , sim_slot& );
+void print_stragglers(input_params& );
+
+#endif
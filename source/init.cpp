@@ -23,6 +23,11 @@ init.cpp contains initialization functions used before actual sensitivity analys
 #include "init.hpp" // Function declarations
 
 #include "analysis.hpp"
+#include "cache.hpp"
+#include "journal.hpp"
+#include "plugin.hpp"
+#include "remote.hpp"
+#include "resources.hpp"
 
 using namespace std;
 
@@ -84,16 +89,104 @@ void accept_params (int num_args, char** args, input_params& ip) {
 				}
 			} else if (strcmp(option, "-l") == 0 || strcmp(option, "--processes") == 0) {
 				ensure_nonempty(option, value);
-				ip.processes = atoi(value);
+				ip.auto_processes = (strcmp(value, "auto") == 0);
+				ip.processes = (ip.auto_processes ? 1 : atoi(value));
 				if (ip.processes < 1) {
 					usage("I doubt you want a zero or negative amount of processes to run.", 0);
 				}
+			} else if (strcmp(option, "-A") == 0 || strcmp(option, "--analysis-threads") == 0) {
+				ensure_nonempty(option, value);
+				ip.analysis_threads = (strcmp(value, "auto") == 0 ? usable_cpus() : atoi(value));
+				if (ip.analysis_threads < 1) {
+					usage("The analysis needs at least one thread.", 0);
+				}
+			} else if (strcmp(option, "-j") == 0 || strcmp(option, "--dims-per-job") == 0) {
+				ensure_nonempty(option, value);
+				ip.auto_dims_per_job = (strcmp(value, "auto") == 0);
+				ip.dims_per_job = (ip.auto_dims_per_job ? 1 : atoi(value));
+				if (ip.dims_per_job < 1) {
+					usage("Every simulation job needs at least one dimension.", 0);
+				}
+			} else if (strcmp(option, "-J") == 0 || strcmp(option, "--sets-per-job") == 0) {
+				ensure_nonempty(option, value);
+				ip.sets_per_job = atoi(value);
+				if (ip.sets_per_job < 1) {
+					usage("Every simulation job needs at least one parameter set.", 0);
+				}
 			} else if (strcmp(option, "-P") == 0 || strcmp(option, "--points") == 0) {
 				ensure_nonempty(option, value);
 				ip.points = atoi(value);
 				if (ip.points < 1) {
 					usage("I doubt you want a zero or negative amount of points to analyze.", 0);
 				}
+			} else if (strcmp(option, "-M") == 0 || strcmp(option, "--method") == 0) {
+				ensure_nonempty(option, value);
+				if (strcmp(value, "lsa") == 0) {
+					ip.method = METHOD_LSA;
+				} else if (strcmp(value, "morris") == 0) {
+					ip.method = METHOD_MORRIS;
+				} else {
+					usage("The method has to be lsa or morris.", 0);
+				}
+			} else if (strcmp(option, "-R") == 0 || strcmp(option, "--trajectories") == 0) {
+				ensure_nonempty(option, value);
+				ip.trajectories = atoi(value);
+				if (ip.trajectories < 1) {
+					usage("Screening needs at least one trajectory.", 0);
+				}
+			} else if (strcmp(option, "-V") == 0 || strcmp(option, "--levels") == 0) {
+				ensure_nonempty(option, value);
+				ip.levels = atoi(value);
+				if (ip.levels < 2 || ip.levels % 2 != 0) {
+					usage("The number of levels of the screening grid has to be even and at least 2.", 0);
+				}
+			} else if (strcmp(option, "-C") == 0 || strcmp(option, "--cache-dir") == 0) {
+				ensure_nonempty(option, value);
+				ip.cache_dir = value;
+			} else if (strcmp(option, "-S") == 0 || strcmp(option, "--stats") == 0) {
+				ensure_nonempty(option, value);
+				ip.stats_file = value;
+			} else if (strcmp(option, "-L") == 0 || strcmp(option, "--listen") == 0) {
+				ensure_nonempty(option, value);
+				ip.listen_port = atoi(value);
+				if (ip.listen_port <= 0 || ip.listen_port > 65535) {
+					usage("You must listen on a port between 1 and 65535.", 0);
+				}
+			} else if (strcmp(option, "-W") == 0 || strcmp(option, "--worker") == 0) {
+				ensure_nonempty(option, value);
+				ip.worker_address = value;
+				if (strchr(value, ':') == NULL) {
+					usage("A worker needs the address of its coordinator as host:port.", 0);
+				}
+			} else if (strcmp(option, "-t") == 0 || strcmp(option, "--tolerance") == 0) {
+				ensure_nonempty(option, value);
+				ip.tolerance = atof(value);
+				if (ip.tolerance < 0) {
+					usage("You must use a positive tolerance, or 0 to simulate every point.", 0);
+				}
+			} else if (strcmp(option, "-x") == 0 || strcmp(option, "--screen") == 0) {
+				ensure_nonempty(option, value);
+				ip.screen = atof(value);
+				if (ip.screen <= 0 || ip.screen >= 100) {
+					usage("The screening threshold is a percentage of the total normalized sensitivity, above 0 and below 100.", 0);
+				}
+			} else if (strcmp(option, "-X") == 0 || strcmp(option, "--screen-top") == 0) {
+				ensure_nonempty(option, value);
+				ip.screen_top = atoi(value);
+				if (ip.screen_top < 1) {
+					usage("You must keep at least one parameter per feature with --screen-top.", 0);
+				}
+			} else if (strcmp(option, "-T") == 0 || strcmp(option, "--deadline") == 0) {
+				ensure_nonempty(option, value);
+				char* unit = NULL;
+				ip.deadline = strtod(value, &unit);
+				ip.relative_deadline = (strcmp(unit, "x") == 0);
+				if (ip.deadline <= 0 || (*unit != '\0' && !ip.relative_deadline)) {
+					usage("The deadline must be a positive number of seconds per parameter set, or a positive multiple of the median time followed by x (e.g. 4x).", 0);
+				}
+			} else if (strcmp(option, "-K") == 0 || strcmp(option, "--kill-late") == 0) {
+				ip.kill_late = true;
+				i--;
 			} else if (strcmp(option, "-p") == 0 || strcmp(option, "--percentage") == 0) {
 				ensure_nonempty(option, value);
 				ip.percentage = atof(value);
@@ -111,6 +204,18 @@ void accept_params (int num_args, char** args, input_params& ip) {
 			} else if (strcmp(option, "-y") == 0 || strcmp(option, "--recycle") == 0) {
 				ip.recycle = true;
 				i--;
+			} else if (strcmp(option, "-r") == 0 || strcmp(option, "--resume") == 0) {
+				ip.resume = true;
+				i--;
+			} else if (strcmp(option, "-b") == 0 || strcmp(option, "--binary-results") == 0) {
+				ip.binary = true;
+				i--;
+			} else if (strcmp(option, "-m") == 0 || strcmp(option, "--memory-data") == 0) {
+				ip.memory_data = true;
+				i--;
+			} else if (strcmp(option, "-w") == 0 || strcmp(option, "--persistent") == 0) {
+				ip.persistent = true;
+				i--;
 			} else if (strcmp(option, "-q") == 0 || strcmp(option, "--quiet") == 0) {
 				ip.quiet = true;
 				i--;
@@ -141,13 +246,18 @@ void accept_params (int num_args, char** args, input_params& ip) {
 	
 	//If a custom name is not included for data_dir, this gives data dir a name of the format "sim-data-[pid]" where the pid is useful to ensure unique working directory.
 	if(ip.data_dir == NULL){
+		if(ip.resume){
+			usage("A run can only be resumed with the --data-dir of the run it continues.", 0);
+		}
 		ip.data_dir = (char*)mallocate(sizeof(char)*(strlen("sim-data-") + len_num(getpid()) + 1));
 		sprintf(ip.data_dir, "%s%d", (char*)"sim-data-", getpid()); 
 	}
 
 	//Making the directories in which all of the simulation data and results will be stored.
 	make_dir(ip.data_dir);
-	make_dir(ip.sense_dir);
+	if(ip.worker_address == NULL){
+		make_dir(ip.sense_dir);
+	}
 	
 	//Use minimum system resources if the user just wants deterministic help menu.
 	if(just_help){
@@ -157,7 +267,22 @@ void accept_params (int num_args, char** args, input_params& ip) {
 	//Setting up quiet mode.
 	if(ip.quiet) cout_switch(true, ip);
 	
-	//Initializing the random seed.
+	//Screening has no rings of points to refine, and its first results file holds mu_star instead of the sensitivities. See morris.cpp.
+	if(ip.method == METHOD_MORRIS){
+		ip.tolerance = 0;
+		ip.screen = 0;
+		ip.screen_top = 0;
+		ip.sense_file = (char*)"mu_star_";
+	}
+	//The screen decides which parameters get every point, so the rings are not refined by --tolerance as well.
+	if(ip.screen > 0 || ip.screen_top > 0){
+		ip.tolerance = 0;
+	}
+	
+	//Initializing the random seed. A resumed run takes the seed of the run it continues unless it is given one.
+	if(ip.resume && ip.random_seed == 0){
+		ip.random_seed = journal_seed(ip);
+	}
 	init_seed(ip);
 	
 	//Initializing some arguments that are always passed into the simulation program. The arguments that need to be filled in are taken care of by file_io.cpp in make_arg()
@@ -172,7 +297,110 @@ void accept_params (int num_args, char** args, input_params& ip) {
 	ip.simulation_args[5] = (char*)"--print-osc-features";
 	ip.simulation_args[7] = (char*)"--seed";
 	ip.simulation_args[sim_args_index] = NULL;
+	
+	//A coordinator's remote workers are persistent workers that always send binary results, and a worker runs every job as a single simulation that writes its features file. See remote.cpp.
+	if(ip.listen_port != 0 && ip.worker_address != NULL){
+		usage("A run can be a coordinator (--listen) or a worker (--worker), but not both.", 0);
+	}
+	if(ip.listen_port != 0){
+		if(ip.generate_only){
+			usage("The features files of a coordinator's jobs are only written on its workers, so --listen cannot be used with --generate-only.", 0);
+		}
+		ip.persistent = true;
+		ip.binary = true;
+		ip.memory_data = false;
+	}
+	if(ip.worker_address != NULL){
+		if(is_plugin(ip.sim_exec)){
+			usage("A worker runs a simulation program, not a simulation plugin.", 0);
+		}
+		ip.persistent = false;
+		ip.binary = false;
+		ip.memory_data = false;
+		ip.cache_dir = NULL;
+	}
+	
+	//A simulation plugin is called with the parameter sets and returns the results directly, so none of the ways of running and talking to simulation programs apply to it. See plugin.cpp.
+	ip.plugin = (ip.listen_port == 0 && is_plugin(ip.sim_exec));
+	if(ip.plugin){
+		if(ip.generate_only){
+			usage("A simulation plugin does not write features files, so it cannot be used with --generate-only.", 0);
+		}
+		ip.persistent = false;
+		ip.binary = false;
+		ip.memory_data = false;
+	}
+	
+	//With --processes auto the pool has a slot for every CPU this program may use, and how many of them are used follows the memory the simulations need. See resources.cpp.
+	if(ip.auto_processes){
+		if(ip.listen_port != 0){
+			usage("A coordinator's simulations run on its workers, so --processes auto cannot be used with --listen.", 0);
+		}
+		ip.processes = usable_cpus();
+		cout << "Using up to " << ip.processes << " simulation processes, one per usable CPU.\n";
+	}
+	
+	//Persistent workers are told to expect a stream of jobs instead of a single set of parameter sets. See start_workers() in io.cpp.
+	if(ip.persistent){
+		add_sim_arg(ip, "--stream-jobs");
+	}
+	//Simulations are asked to send their results through --pipe-out. Generating data only is about keeping the features files, so the results are not sent then.
+	if(ip.generate_only){
+		ip.binary = false;
+	}
+	//In-memory data files only live as long as this program, so there is nothing to keep with --generate-only or to read with --recycle.
+	if(ip.generate_only || ip.recycle){
+		ip.memory_data = false;
+	}
+	if(ip.memory_data){
+		ip.delete_data = true;
+	}
+	//Refining the points needs the sensitivity of every ring, so every point is simulated when only the features files are wanted or when they are recycled.
+	if(ip.generate_only || ip.recycle){
+		ip.tolerance = 0;
+		ip.screen = 0;
+		ip.screen_top = 0;
+	}
+	if(ip.binary){
+		add_sim_arg(ip, "--binary-results");
+	}
+	//The features files of --generate-only and --recycle are one per dimension, so their dimensions are neither packed nor split.
+	if(ip.generate_only || ip.recycle){
+		ip.dims_per_job = 1;
+		ip.auto_dims_per_job = false;
+		ip.sets_per_job = 0;
+	}
+	//The cache holds results that were sent back or read from the features files, so it has nothing to offer when only the features files are generated, and recycled files are not simulated at all.
+	if(ip.generate_only || ip.recycle){
+		ip.cache_dir = NULL;
 	}
+	if(ip.cache_dir != NULL){
+		open_cache(ip);
+	}
+	//The journal holds the results that were collected, so there is nothing to journal when only the features files are generated, when they are recycled or on a worker. With --memory-data no results are written to the data directory at all, so there is no journal to resume either.
+	if(ip.memory_data && ip.resume){
+		usage("A run with --memory-data keeps no journal in the data directory, so it cannot be resumed.", 0);
+	}
+	if(ip.generate_only || ip.recycle || ip.worker_address != NULL || ip.memory_data){
+		ip.resume = false;
+	} else{
+		open_journal(ip);
+	}
+}
+
+/*	Adds an argument for the simulation program right after the arguments that are always passed (--pipe-in, --pipe-out, --print-osc-features and --seed), ahead of any arguments given with --sim-args.
+	This is used for the optional extensions of the communication protocol that the simulation has to be told about.
+*/
+void add_sim_arg (input_params& ip, const char* arg) {
+	char** args = new char*[ip.sim_args_num + 1];
+	memcpy(args, ip.simulation_args, sizeof(char*)*9);
+	args[9] = (char*)arg;
+	memcpy(args + 10, ip.simulation_args + 9, sizeof(char*)*(ip.sim_args_num - 9));
+	delete[] ip.simulation_args;
+	ip.simulation_args = args;
+	ip.sim_args_num++;
+	ip.protocol_args++;
+}
 
 void ensure_nonempty (const char* flag, const char* arg) {
 	if (arg == NULL) {
@@ -27,15 +27,34 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 #include <cmath>		//(Needed for isinf() checks and log10 call.)
 #include <sys/stat.h>	//(Used for file and directory checking and making)
 #include <errno.h>		//(Some libraries use error codes that are useful for checking things, like mkdir)
+#include <stdint.h>		//(Fixed size integers for the cache keys.)
 
 #include "memory.hpp" 	//(Memory tracking functions.)
 #include "macros.hpp"	//(macros)
+#include "matrix.hpp"	//(The matrix struct for arrays of values.)
 using namespace std;
 
 //Declaring this here so it can be used by the input_params destructor.
 void unmake_dir(char*);
 void unmake_file(char* , bool );
 
+//The simulation pool and the nominal parameter sets index are defined in io.hpp, and the journal in journal.hpp.
+struct sim_pool;
+struct nominal_index;
+struct run_journal;
+struct run_stats;
+struct work_pool;
+
+//Struct for the column layout of the features files, which is taken from the first file that is read so that the names line of every other file with the same layout is skipped instead of parsed. See load_output() in io.cpp.
+struct output_layout{
+	size_t header_len; //The number of characters in the names line of the file the layout was taken from, without the newline.
+	int num_types; //The number of output features in the layout, or -1 if no file has been read yet.
+	output_layout(){
+		header_len = 0;
+		num_types = -1;
+	}
+};
+
 //Struct for holding on to input arguments and values.
 struct input_params{	
 	bool sim_args;
@@ -43,21 +62,46 @@ struct input_params{
 	bool recycle;
 	bool delete_data;
 	bool generate_only;
+	bool binary; //Whether the simulations send their results back through the --pipe-out pipe instead of only writing the features files. See io.cpp.
+	bool memory_data; //Whether the features files are anonymous in-memory files instead of files in data_dir. See open_memory_file() in io.cpp.
+	bool persistent; //Whether the simulations are run by persistent workers that are streamed one job after another. See start_pool() in io.cpp.
+	int listen_port; //The port a coordinator listens on for remote workers, or 0 if the simulations are run on this machine. See remote.cpp.
+	char* worker_address; //With --worker, the "host:port" of the coordinator this program works for, otherwise NULL.
+	bool plugin; //Whether --exec names a simulation plugin that is called from threads of this program instead of a simulation program. See plugin.cpp.
+	bool resume; //Whether the run continues the run whose journal is in data_dir. See journal.cpp.
 	int random_seed;
 	int processes;
+	bool auto_processes; //Whether processes is the number of usable CPUs and the number of simulations run at once follows the available memory (--processes auto). See resources.cpp.
+	int dims_per_job; //The number of dimensions whose perturbed sets one simulation runs together. See next_sim_job() in schedule.cpp.
+	bool auto_dims_per_job; //Whether dims_per_job follows the measured startup and per-set cost of the simulation (--dims-per-job auto). See resources.cpp.
+	int sets_per_job; //The largest number of perturbed sets of one dimension that one simulation runs, or 0 if a dimension is never split among several simulations.
+	int analysis_threads; //The number of threads, including the main thread, that calculate the finite differences of a nominal set. See threads.cpp.
 	int sim_args_num;
+	int protocol_args; //The number of arguments added by add_sim_arg() in init.cpp, which follow the 9 arguments that are always passed to the simulation.
 	int num_nominal;
 	int set_skip;
 	int dims;
 	double percentage; //Max percentage by which we will perturb parameters +/-
 	int points; //Number of points between the nominal and the max percentage +/- to generate data for
+	int method; //METHOD_LSA, or METHOD_MORRIS for elementary effects screening. See morris.cpp.
+	int trajectories; //With --method morris, the number of one-at-a-time trajectories per nominal set.
+	int levels; //With --method morris, the number of levels of the grid the trajectories move on, which is even.
+	double tolerance; //With a positive tolerance the points are simulated one ring at a time until the sensitivity converges. See dim_converged() in analysis.cpp.
+	double screen; //With a positive screen, every dimension is first simulated with only its closest ring, and only those with a normalized sensitivity above this percentage get the rest of the points. See screen_dims() in analysis.cpp.
+	int screen_top; //With a positive screen_top, the dimensions with one of the screen_top largest normalized sensitivities of any feature also get the rest of the points.
+	double deadline; //The time a job may take per parameter set before it is late, in seconds or (if relative_deadline) as a multiple of the median, or 0 for no deadline. See deadline.cpp.
+	bool relative_deadline;
+	bool kill_late; //Whether late jobs are killed and their sets marked as failed instead of being copied to an idle slot.
 	double* nominal; //Array for storing the nominal parameter set.
+	nominal_index* sets; //The index of the nominal parameter sets file, or NULL if it has not been read yet. See read_nominal() in io.cpp.
 	streambuf* cout_orig;
 	ofstream* null_stream;
 	char* nominal_file;
 	char* sense_dir;
 	char* sense_file;
 	char* norm_file;
+	char* cache_dir; //The directory of the simulation results cache, or NULL if the cache is not used. See cache.cpp.
+	uint64_t cache_key; //The hash of everything besides the parameter values that the simulation results depend on.
 	char* data_dir;
 	char* nom_file;
 	char*dim_file;
@@ -65,6 +109,13 @@ struct input_params{
 	char** simulation_args;
 	char* failure;
 	int failcode;
+	output_layout layout; //The layout of the features files, which all simulations of a run share.
+	sim_pool* pool; //The simulation processes shared by all nominal sets, or NULL if they have not been started.
+	run_journal* journal; //The journal of the finished jobs and sets, or NULL if the run does not keep one. See journal.cpp.
+	char* stats_file; //With --stats, the file the statistics report is written to, otherwise NULL.
+	run_stats* stats; //The time spent in every phase of the run so far, or NULL without --stats. See stats.cpp.
+	work_pool* workers; //The threads that help the main thread with the analysis, or NULL if it works alone. See threads.cpp.
+	mem_arena* spare_arenas; //The arenas of the nominal sets that have finished, which the next nominal sets reuse. See nominal_run.
 	
 	input_params(){
 		quiet = false;
@@ -72,17 +123,44 @@ struct input_params{
 		recycle = false;
 		delete_data = false;
 		generate_only = false;
+		binary = false;
+		memory_data = false;
+		persistent = false;
+		plugin = false;
+		resume = false;
+		listen_port = 0;
+		worker_address = NULL;
 	 	dims= 0;
 	 	percentage = 5;
 	 	points = 2;
+		method = METHOD_LSA;
+		trajectories = 10;
+		levels = 4;
+		tolerance = 0;
+		screen = 0;
+		screen_top = 0;
+		deadline = 0;
+		relative_deadline = false;
+		kill_late = false;
 	 	processes = 2;
+		auto_processes = false;
+		dims_per_job = 1;
+		auto_dims_per_job = false;
+		sets_per_job = 0;
+		analysis_threads = 1;
+		protocol_args = 0;
 	 	num_nominal = 1;
 	 	set_skip = 0;
+		random_seed = 0;
+		nominal = NULL;
+		sets = NULL;
 		nominal_file = (char*)"nominal.params";
 		sense_dir = (char*)"SA-data";
 		sense_file = (char*)"LSA_";
 		norm_file = (char*)"normalized_";
 		data_dir = NULL;
+		cache_dir = NULL;
+		cache_key = 0;
 		nom_file = (char*)"nominal_"; 	//This string is just used as the name to give to the nominal oscillation features file.
 		dim_file = (char*)"dim_";		//Similarly, this string is used to name the oscillation features file for each dimension (parameter) of the system with perturbations.
 		sim_exec = (char*) "../simulation/simulation";
@@ -90,11 +168,18 @@ struct input_params{
 		null_stream = NULL;
 		failure = NULL;
 		failcode = 0;
+		pool = NULL;
+		journal = NULL;
+		stats_file = NULL;
+		stats = NULL;
+		workers = NULL;
+		spare_arenas = NULL;
 	}
 	
 	~input_params(){
 		if(nominal != NULL) delete[] nominal;
 		if(simulation_args != NULL) delete[] simulation_args;
+		free_arenas(spare_arenas);
 		if(data_dir != NULL){
 			if(delete_data){
 				unmake_dir(data_dir);
@@ -107,25 +192,34 @@ struct input_params{
 //Struct for holding all the sets that need to be simulated.
 struct sim_set{
 	int dims; //Just holds a copy of how many dimensions/parameters are being used.
-	int sets_per_dim; //Number of sets to simulate for data per dimension that will be perturbed.
+	int jobs; //The number of jobs besides the nominal set, which is one per dimension, or one per trajectory with --method morris.
+	int sets_per_dim; //Number of sets to simulate for data per dimension that will be perturbed (or per trajectory).
 	int points; //Just holds a copy of the number of points to use.
 	double step_per_set; //Decimal difference between perturbations.
-	double** dim_sets; //An array for holding the perturbed values. See fill() for a description of the structure of this array.
-	sim_set(input_params& ip){
+	matrix* dim_sets; //A dims x sets_per_dim matrix for holding the perturbed values, which comes from the arena of the nominal set. See fill() for a description of the structure of this matrix.
+	matrix* trajectories; //With --method morris, a (jobs * sets_per_dim) x dims matrix with every parameter set of every trajectory, one trajectory after another, otherwise NULL. See make_trajectories() in morris.cpp.
+	int* order; //With --method morris, for every trajectory the dimension that each of its steps changes.
+	sim_set(input_params& ip, mem_arena* arena){
 		dims = ip.dims;
 		points = ip.points;
+		if(ip.method == METHOD_MORRIS){
+			jobs = ip.trajectories;
+			sets_per_dim = dims + 1;
+			step_per_set = 0;
+			dim_sets = NULL;
+			trajectories = arena_matrix(arena, jobs * sets_per_dim, dims, ROW_MAJOR);
+			order = (int*)arena_alloc(arena, sizeof(int) * jobs * dims);
+			return;
+		}
+		jobs = dims;
 		sets_per_dim = 2*ip.points;
 		step_per_set = (ip.percentage /( (double)100*ip.points ));
-		dim_sets = new double*[dims];
+		dim_sets = arena_matrix(arena, dims, sets_per_dim, ROW_MAJOR);
+		trajectories = NULL;
+		order = NULL;
 		this->fill(ip.nominal);
 		
 	}
-	~sim_set(){
-		for(int i = 0; i < dims; i++){
-			delete[] dim_sets[i];
-		}
-		delete[] dim_sets;
-	}
 	
 	/*	This funciton fills the array dim_sets using the nominal parameter values and the calculated perterbation.
 		The rows of dim_sets are parameter indicies, the columns are the parameter values with increasing amounts of perturbation (from most-negative to most-positive).
@@ -141,20 +235,188 @@ struct sim_set{
 	*/
 	void fill(double* nominal){
 		for(int i = 0; i < dims; i++){
-			dim_sets[i] = new double[sets_per_dim];
+			double* inserts = dim_sets->row(i);
 			int j = 0;
 			for(; j < points; j++){
-				dim_sets[i][j] = at_least_zero( nominal[i] * ((double)1 + step_per_set*(double)(j - points)) );
+				inserts[j] = at_least_zero( nominal[i] * ((double)1 + step_per_set*(double)(j - points)) );
 			}
 			j++;
 			for(; j < sets_per_dim + 1; j++){
-				dim_sets[i][j-1] = at_least_zero( nominal[i] * ((double)1 + step_per_set*(double)(j - points)) );
+				inserts[j-1] = at_least_zero( nominal[i] * ((double)1 + step_per_set*(double)(j - points)) );
 			}
 		}
 	}
 };
 
 
+/*	Struct for one nominal parameter set while it is being simulated and analyzed.
+	Several nominal sets can be in flight at once (see schedule.cpp), so each one keeps its own copy of the nominal values, its perturbed sets and the directory its simulation data is written to.
+	Its jobs are the nominal set (JOB_NOMINAL) followed by every dimension in order, or by every trajectory with --method morris. The arrays per dimension below are per job then, and the jobs are still called dimensions.
+	Everything a nominal set needs until its sensitivity is written (its arrays, perturbed sets, results and the names of its features) comes from its arena, which goes back to ip.spare_arenas in one piece when the set is deleted. The next nominal set takes it from there, so once the arenas have grown to the size of a set, reading, simulating and analyzing further sets does not allocate them again.
+*/
+struct nominal_run{
+	int index; //The index of this nominal set in the nominal file, which is used to name its results.
+	double* nominal; //This set's copy of the nominal parameter values.
+	sim_set* ss; //The perturbed sets of this nominal set.
+	char* dir; //The directory in which the simulation data of this set is stored.
+	int next_job; //The next job that has to be started.
+	int unfinished; //The number of jobs that have not finished yet.
+	int num_features; //The number of output features, or -1 until the results of the first job are in.
+	char** output_names; //The names of the output features, which come with the results of the nominal set.
+	matrix* nominal_output; //The output features of the nominal set, a num_features x 1 matrix.
+	matrix** dim_output; //The output features of every dimension, each a num_features x sets_per_dim matrix, or NULL for dimensions whose results are not in yet.
+	bool adaptive; //Whether the perturbations of each dimension are simulated one ring at a time (see ip.tolerance) or screened first (see ip.screen) instead of all at once.
+	bool screened; //With --screen or --screen-top, whether the dimensions that get the rest of their rings have been chosen yet.
+	int* first_ring; //For every dimension, the first ring of the rings it simulates next, up to rings. See add_rings().
+	int* rings; //The number of rings of every dimension that have been started, where ring r is the pair of perturbations r points away from the nominal value (on either side).
+	int* columns; //For every dimension, the columns of dim_output (i.e. the perturbed sets) that its running job simulates, with room for sets_per_dim columns per dimension. See plan_job() in io.cpp.
+	int* job_count; //The number of sets every job (the nominal set first) simulates.
+	int* copies; //For every perturbed set (with room for sets_per_dim per dimension, like columns), the column of the same dimension with exactly the same parameter values whose results it shares instead of being simulated, or -1. See share_sets().
+	bool* constant; //Whether every perturbed value of a dimension is its nominal value, i.e. its nominal value is 0. Such dimensions have zero sensitivity and are not simulated at all.
+	int* refine; //The dimensions that need another ring, which are started before the dimensions that have not been started at all.
+	int refine_count; //The number of dimensions in refine.
+	matrix* estimates; //With adaptive rings, the sensitivities from the last ring of every dimension (dims x num_features), or NULL until the first ring is in.
+	int* pieces; //For every job (the nominal set first), the number of simulations of it that have not finished yet, which is more than 1 while the pieces of a split dimension are running.
+	int split_dim; //The dimension whose pieces are being started, or JOB_NOMINAL if there is none. See next_sim_job() in schedule.cpp.
+	int split_count; //The number of pieces split_dim is split into.
+	int split_next; //The next piece of split_dim to start.
+	bool* failed; //For every job (the nominal set first), whether it was killed at its deadline (see deadline.cpp). A dimension whose job was killed has no sensitivity, and a set whose nominal job was killed has no results at all.
+	double times[STAT_PHASES]; //With --stats, the time spent in every phase of this set, in seconds, where waiting is the time spent waiting for its jobs to finish. See stats.cpp.
+	double admitted; //With --stats, when this set was read in, in seconds.
+	int jobs_done; //With --stats, the number of jobs of this set that were simulated.
+	int sets_done; //With --stats, the number of parameter sets of this set that were simulated.
+	mem_arena* arena; //The arena that everything of this set is allocated from.
+	mem_arena** spares; //The list the arena goes back to, i.e. ip.spare_arenas.
+	nominal_run(input_params& ip){
+		MEM_TAG(MEM_SIM_SET);
+		spares = &ip.spare_arenas;
+		arena = take_arena(spares);
+		index = ip.set_skip - 1;
+		nominal = alloc<double>(ip.dims);
+		memcpy(nominal, ip.nominal, sizeof(double)*ip.dims);
+		ss = new (alloc<sim_set>(1)) sim_set(ip, arena);
+		dir = NULL;
+		next_job = JOB_NOMINAL;
+		unfinished = ss->jobs + 1;
+		num_features = -1;
+		output_names = NULL;
+		nominal_output = NULL;
+		dim_output = alloc<matrix*>(ss->jobs);
+		for(int i = 0; i < ss->jobs; i++){
+			dim_output[i] = NULL;
+		}
+		adaptive = (ip.tolerance > 0 || ip.screen > 0 || ip.screen_top > 0);
+		screened = false;
+		rings = alloc<int>(ss->jobs);
+		first_ring = alloc<int>(ss->jobs);
+		columns = alloc<int>(ss->jobs * ss->sets_per_dim);
+		job_count = alloc<int>(ss->jobs + 1);
+		job_count[0] = 1;
+		for(int i = 0; i < ss->jobs; i++){
+			for(int j = 0; j < ss->sets_per_dim; j++){
+				columns[i * ss->sets_per_dim + j] = j;
+			}
+			job_count[i + 1] = ss->sets_per_dim;
+		}
+		copies = alloc<int>(ss->jobs * ss->sets_per_dim);
+		constant = alloc<bool>(ss->jobs);
+		share_sets();
+		refine = alloc<int>(ss->jobs);
+		for(int i = 0; i < ss->jobs; i++){
+			rings[i] = (adaptive ? 1 : ss->points);
+			first_ring[i] = 1;
+		}
+		refine_count = 0;
+		estimates = NULL;
+		failed = alloc<bool>(ss->jobs + 1);
+		pieces = alloc<int>(ss->jobs + 1);
+		for(int i = 0; i <= ss->jobs; i++){
+			failed[i] = false;
+			pieces[i] = 0;
+		}
+		split_dim = JOB_NOMINAL;
+		split_count = 0;
+		split_next = 0;
+		for(int i = 0; i < STAT_PHASES; i++){
+			times[i] = 0;
+		}
+		admitted = 0;
+		jobs_done = 0;
+		sets_done = 0;
+	}
+	~nominal_run(){
+		if(dir != NULL) mfree(dir);
+		give_arena(spares, arena);
+	}
+	
+	//Allocates an array of count T's from the arena of this set.
+	template<typename T> T* alloc(int count){
+		return (T*)arena_alloc(arena, sizeof(T)*count);
+	}
+	
+	//The columns that job dim simulates, of which there are job_count[dim + 1].
+	int* job_columns(int dim){
+		return columns + dim * ss->sets_per_dim;
+	}
+	
+	//Returns the ring of column column of a dimension's perturbed sets, counting from 1 for the two sets closest to the nominal set.
+	int ring_of(int column){
+		return (column < ss->points ? ss->points - column : column - ss->points + 1);
+	}
+	
+	/*	Fills in copies and constant, so that no parameter set is simulated twice for this nominal set.
+		The perturbations are a percentage of the nominal value, so a nominal value of 0 makes every perturbed set of its dimension the nominal set itself. With --percentage 100 or more, the at_least_zero() clamp in sim_set::fill() makes several sets on the negative side the same.
+		A set shares the results of the set with the same value in the lowest ring, so that with adaptive rings the shared set is always simulated first.
+	*/
+	void share_sets(){
+		//The sets of a trajectory all differ, and none of them is the nominal set.
+		if(ss->trajectories != NULL){
+			for(int i = 0; i < ss->jobs * ss->sets_per_dim; i++){
+				copies[i] = -1;
+			}
+			memset(constant, 0, sizeof(bool) * ss->jobs);
+			return;
+		}
+		for(int i = 0; i < ss->dims; i++){
+			double* inserts = ss->dim_sets->row(i);
+			int* shared = copies + i * ss->sets_per_dim;
+			constant[i] = true;
+			for(int j = 0; j < ss->sets_per_dim; j++){
+				constant[i] = constant[i] && inserts[j] == nominal[i];
+				shared[j] = -1;
+				for(int k = 0; k < ss->sets_per_dim; k++){
+					if(inserts[k] == inserts[j] && (ring_of(k) < ring_of(j) || (ring_of(k) == ring_of(j) && k < j)) && (shared[j] == -1 || ring_of(k) < ring_of(shared[j]))){
+						shared[j] = k;
+					}
+				}
+			}
+		}
+	}
+	
+	//Whether every job of this set has been started, for now: a dimension can still need another ring once its results are in.
+	bool dispatched(){
+		return next_job >= ss->jobs && refine_count == 0 && split_next == split_count;
+	}
+	
+	//Returns the next job that has to be started and counts it as started. Another ring of a dimension goes before the dimensions that have not been started.
+	int take_job(){
+		int dim;
+		if(refine_count > 0){
+			dim = refine[--refine_count];
+		} else{
+			dim = next_job++;
+		}
+		return dim;
+	}
+	
+	//Queues dimension dim to simulate the rings after the ones it has simulated so far, up to ring last. They are started before the dimensions that have not been started.
+	void add_rings(int dim, int last){
+		first_ring[dim] = rings[dim] + 1;
+		rings[dim] = last;
+		refine[refine_count++] = dim;
+	}
+};
+
 //Init functions
 char* copy_str (const char* );
 void init_seed (input_params& );
@@ -162,5 +424,6 @@ void accept_params (int , char** , input_params& );
 void ensure_nonempty (const char* , const char* );
 void cout_switch(bool , input_params& );
 void make_dir(char*);
+void add_sim_arg(input_params& , const char* );
 double check_num(double );
 #endif
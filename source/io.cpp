@@ -22,76 +22,192 @@ io.cpp contains functions for input and output of files and pipes. All I/O relat
 
 #include "io.hpp" // Function declarations
 
+#include "cache.hpp"
+#include "deadline.hpp"
 #include "init.hpp"
+#include "journal.hpp"
+#include "plugin.hpp"
+#include "remote.hpp"
+#include "resources.hpp"
+#include "stats.hpp"
 #include "macros.hpp"
 
 using namespace std;
 
+/*	Reads in the whole file with the given name. Regular files are mapped into memory rather than copied, anything else (e.g. a pipe) is read in once.
+	The number of bytes is stored in size and whether the data was mapped in mapped. The data has to be released with unmap_file().
+	Returns NULL if the file could not be opened.
+*/
+char* map_file (char* file_name, size_t* size, bool* mapped) {
+	int fd = open(file_name, O_RDONLY);
+	if(fd == -1){
+		return NULL;
+	}
+	char* data = NULL;
+	*size = 0;
+	*mapped = false;
+	struct stat info;
+	if(fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0){
+		void* region = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+		if(region != MAP_FAILED){
+			data = (char*)region;
+			*size = info.st_size;
+			*mapped = true;
+			madvise(region, info.st_size, MADV_SEQUENTIAL);
+		}
+	}
+	//Streams the file in if it could not be mapped.
+	if(!*mapped){
+		size_t capacity = 4096;
+		data = new char[capacity];
+		ssize_t got;
+		while((got = read(fd, data + *size, capacity - *size)) != 0){
+			if(got == -1){
+				if(errno == EINTR) continue;
+				break;
+			}
+			*size += got;
+			if(*size == capacity){
+				char* larger = new char[2 * capacity];
+				memcpy(larger, data, *size);
+				delete[] data;
+				data = larger;
+				capacity *= 2;
+			}
+		}
+	}
+	close(fd);
+	return data;
+}
+
+//Releases data that was read in by map_file().
+void unmap_file (char* data, size_t size, bool mapped) {
+	if(mapped){
+		munmap(data, size);
+	} else{
+		delete[] data;
+	}
+}
+
+/*	Reads the next nominal parameter set (the set at index ip.set_skip, not counting blank and comment lines) into ip.nominal and increments ip.set_skip.
+	The file is read only once, the first time this function is called, and every set is then taken from its index (see index_nominal()), so reading a set does not depend on how many sets come before it.
+	If the set could not be read, ip.nominal is set to NULL.
+*/
 void read_nominal (input_params& ip) {
-	//Opens the file for reading.
-	FILE* file_pointer = fopen(ip.nominal_file, "r");
-	if (file_pointer == NULL) {
-		cout << "Could not open the output file.\n";
-		exit(1);
+	//If this is the first nominal set that is read, the file needs to be indexed and we need to set our count of how many parameters there are and initiatlize the nominal array.
+	if(ip.sets == NULL){
+		ip.sets = index_nominal(ip.nominal_file);
+		if(ip.sets == NULL){
+			cout << "Could not open the nominal parameter sets file.\n";
+			exit(1);
+		}
+	}
+	nominal_index& index = *ip.sets;
+	if(ip.set_skip >= index.num_sets){
+		cerr << "There are only " << index.num_sets << " parameter sets in the file " << ip.nominal_file << "\n";
+		if(ip.nominal != NULL) delete[] ip.nominal;
+		ip.nominal = NULL;
+		return;
 	}
-	//If this is the first nominal set that is read, we need to set our count of how many parameters there are and initiatlize the nominal array
+	//Copy the set into the line buffer so that it can be parsed as a string.
+	size_t length = index.end[ip.set_skip] - index.start[ip.set_skip];
+	memcpy(index.line, index.data + index.start[ip.set_skip], length);
+	index.line[length] = '\0';
+	ip.set_skip ++;
 	if(ip.dims < 1){
-		ip.dims = count_params(file_pointer);
+		ip.dims = count_params(index.line);
 		ip.nominal = new double[ip.dims];
 	}
-	//Skips over any lines that have already been used as nominal sets. Then increments the number of lines that will need to be skipped over in the future.
-	skip_lines( file_pointer, ip.set_skip);
-	ip.set_skip ++;
 	//A call to the fill_doubles founction with an error check.
-	if(! fill_doubles(file_pointer, ip.dims, ip.nominal)){
+	if(ip.nominal == NULL || !fill_doubles(index.line, ip.dims, ip.nominal)){
 		cerr << "There are less than " << ip.dims << " values in the file " << ip.nominal_file << "\n";	
-		delete[] ip.nominal;
+		if(ip.nominal != NULL) delete[] ip.nominal;
 		ip.nominal = NULL;
 	}
-	//Close the nominal file.
-	fclose(file_pointer);
 }
 
-int count_params (FILE* file_pointer) {
+/*	Reads the nominal parameter sets file with the given name and indexes the lines that hold parameter sets, skipping blank lines and lines beginning with '#'.
+	Returns the index, or NULL if the file could not be opened.
+*/
+nominal_index* index_nominal (char* file_name) {
+	nominal_index* index = new nominal_index();
+	index->data = map_file(file_name, &index->size, &index->mapped);
+	if(index->data == NULL){
+		delete index;
+		return NULL;
+	}
+	
+	//Count the lines first so that the offset arrays can be allocated once.
+	const char* data = index->data;
+	size_t lines = 1;
+	for(const char* c = data; (c = (const char*)memchr(c, '\n', data + index->size - c)) != NULL; c++){
+		lines++;
+	}
+	index->start = new size_t[lines];
+	index->end = new size_t[lines];
+	size_t longest = 0;
+	size_t pos = 0;
+	while(pos < index->size){
+		const char* newline = (const char*)memchr(data + pos, '\n', index->size - pos);
+		size_t line_end = (newline == NULL ? index->size : newline - data);
+		size_t first = pos;
+		while(first < line_end && (data[first] == ' ' || data[first] == '\t' || data[first] == '\r')){
+			first++;
+		}
+		//Blank lines and comments are not parameter sets.
+		if(first < line_end && data[first] != '#'){
+			index->start[index->num_sets] = pos;
+			index->end[index->num_sets] = line_end;
+			index->num_sets++;
+			if(line_end - pos > longest){
+				longest = line_end - pos;
+			}
+		}
+		pos = line_end + 1;
+	}
+	index->line = new char[longest + 1];
+	return index;
+}
+
+/*	Frees the index of the nominal parameter sets file, if it was read.
+*/
+void close_nominal (input_params& ip) {
+	if(ip.sets != NULL){
+		delete ip.sets;
+		ip.sets = NULL;
+	}
+}
+
+/*	Counts the parameters in a parameter set, i.e. every sequence of decimal numbers in the string.
+*/
+int count_params (const char* line) {
 	int count = 0;
 	bool  in_num = false;
-	char c = '\0';
-	int read = 1;
-	//For every character in the first line of the file, increment the count for each sequence of decimal numbers.
-	for(; c != '\n' && read == 1; read = fscanf(file_pointer, "%c", &c)){
-		if(!in_num && is_num(c)){
+	for(; *line != '\0'; line++){
+		if(!in_num && is_num(*line)){
 			count++;
 		}
-		in_num = is_num(c);
+		in_num = is_num(*line);
 	}
-	//Rewind the file pointer back to the beginning.
-	rewind(file_pointer);
 	return count;	
 }
 
-bool fill_doubles (FILE* file_pointer, int param_num, double* nominal) {
-	int result = 0;
+/*	Reads param_num values separated by commas, semicolons, tabs or spaces from the string into nominal.
+	Returns false if there are fewer than param_num values.
+*/
+bool fill_doubles (const char* line, int param_num, double* nominal) {
+	char* next = NULL;
 	for(int i = 0; i < param_num; i++){
-		result = fscanf(file_pointer, "%lf%*[,;\t ]", nominal+i); 
-		if ( 1 != result){
+		nominal[i] = strtod(line, &next);
+		if(next == line){
 			return false;
 		}
+		line = next + strspn(next, ",;\t \r");
 	}
 	return true;
 }
 
-void skip_lines (FILE* file_pointer, int set_skip) {
-	char pound = '\0';
-	for(int i = 0; i < set_skip; i++){
-		fscanf(file_pointer,"%c", &pound);
-		if(pound == '#'){
-			i--;
-		} 
-		fscanf(file_pointer, "%*s\n");
-	}
-}
-
-/*	This functions puts output features data into a double[j][i] where j is the index of an output feature and i is the index of the value of that feature at a particular perturbation.
+/*	This functions puts output features data into a matrix where the value at row j, column i is the value of output feature j at a particular perturbation i. The matrix has COL_MAJOR layout, so the features of one perturbation (one line of the file) are next to each other.
 This function also counts how many features there are and stores that value in num_types. Also, if ouptput_names is not NULL, this function puts the names of each output feature in a char** and has output_names point to that array.
 	Note that this function can be prone to misreading data if the format of output features files changes. Currently the file is expected to look like:
 
@@ -101,74 +217,137 @@ set,post sync wildtype,post per wildtype,post amp wildtype,post per wildtype/wt,
 	
 	where the number of features can be arbitrary but 0) at most MAX_NUM_FEATS will be read, 1) all values must be comma-seperated with no spaces, 2) the names line must contain a name for every feature, 3) the last value in non-name lines must be followed by a comma, but can have any string after that before the new line, 4) The maximum number of features that can be read is set by the macro MAX_NUM_FEATS and is currently 150. 
 	Also important is the fact that there should be no name for the "PASSED" or "FAILED" column which needs to be ignored.
+	The file is read in whole with map_file() and split at its commas with next_separator(). If layout is not NULL, the number of features is taken from it when the names line of the file ends where the one the layout was made from ended, and the names line is not read at all. Otherwise the names line is counted and stored in layout.
+	If arena is not NULL, the matrix and the names are allocated from it (see arena_matrix() in matrix.hpp), and must not be deleted.
 */
-double** load_output (int num_values, int* num_types, char* file_name, char*** output_names) {
-	//Open the file for reading.
-	FILE* file_pointer = fopen(file_name, "r");
-	//Count how many types of output there are, and fill keep track of their (possibly partial) names.
+matrix* load_output (int num_values, int* num_types, char* file_name, char*** output_names, output_layout* layout, mem_arena* arena) {
+	MEM_TAG(MEM_LOAD_OUTPUT);
+	//Read in the file.
+	size_t size = 0;
+	bool mapped = false;
+	char* data = map_file(file_name, &size, &mapped);
+	if(data == NULL){
+		*num_types = 0;
+		return NULL;
+	}
+	const char* end = data + size;
+	const char* header_end = NULL;
 	int output_types = 0;
-	//Only store the names if the call to the function has a place for it.
-	bool name_store = (output_names != NULL);
-	if(name_store){
-		(*output_names) = new char*[MAX_NUM_FEATS];
-	}
-	//An index for putting characters within the output names array
-	int o_n_index = 0;
-	fscanf(file_pointer, "set,"); // skip the first column containing set number
-	for(char c = '\0'; c != '\n'; fscanf(file_pointer, "%c", &c)){
-		if( c == ','){
-			output_types ++;
-			//With a new comma, this assumes that another output type will be filled in.
-			if(name_store && output_types < MAX_NUM_FEATS){
-				o_n_index = 0; //Still taking feature names, so reset the string index to the beginning.
-			} else{
-				o_n_index = 50; //output_names must be full, so ensure that it will not be touched further.
-			}
-			
-		} else{
-			if (o_n_index < 48 && name_store && alph_num_slash(c)){
-				//cout << c << " "; 
-				if(o_n_index == 0){
-					(*output_names)[output_types] = new char[50];
+	//Every features file of a run is written by the same simulation, so a names line of the same length as the cached one is taken to name the same features, and the values start right after it.
+	if(layout != NULL && layout->num_types >= 0 && layout->header_len <= size && (layout->header_len == size || data[layout->header_len] == '\n')){
+		header_end = data + layout->header_len;
+		output_types = layout->num_types;
+	} else{
+		header_end = (const char*)memchr(data, '\n', size);
+		if(header_end == NULL){
+			header_end = end;
+		}
+		const char* pos = data;
+		if(header_end - data >= 4 && memcmp(pos, "set,", 4) == 0){
+			pos += 4; // skip the first column containing set number
+		}
+		while((pos = next_separator(pos, header_end)) < header_end){
+			output_types++;
+			pos++;
+		}
+		//Ensure that at most MAX_NUM_FEATS features are used for the rest of the processing.
+		output_types = min(output_types, MAX_NUM_FEATS);
+		if(layout != NULL){
+			layout->header_len = header_end - data;
+			layout->num_types = output_types;
+		}
+	}
+	size_t header_len = header_end - data;
+	//Only store the names if the call to the function has a place for it. Only letters, numbers, slashes and spaces are kept, and at most 48 of them.
+	if(output_names != NULL){
+		(*output_names) = (arena != NULL ? (char**)arena_alloc(arena, sizeof(char*)*MAX_NUM_FEATS) : new char*[MAX_NUM_FEATS]);
+		const char* pos = data;
+		if(header_len >= 4 && memcmp(pos, "set,", 4) == 0){
+			pos += 4;
+		}
+		for(int j = 0; j < output_types; j++){
+			const char* name_end = next_separator(pos, header_end);
+			char* name = (*output_names)[j] = (arena != NULL ? (char*)arena_alloc(arena, 50) : new char[50]);
+			int length = 0;
+			for(; pos < name_end && length < 48; pos++){
+				if(alph_num_slash(*pos)){
+					name[length++] = *pos;
 				}
-				(*output_names)[output_types][o_n_index] = c;
-				(*output_names)[output_types][o_n_index+1] = '\0';
-				o_n_index ++;
-				//cout <<"\n"<< (*output_names)[output_types][o_n_index] << "___" << (*output_names)[output_types];
 			}
-			
+			name[length] = '\0';
+			pos = name_end + 1;
 		}
 	}
-	//Ensure that at most MAX_NUM_FEATS features are used for the rest of the processing.
-	output_types = min(output_types, MAX_NUM_FEATS);
-
+	
 	//Fill in the function parameter with the output_types count.
 	*num_types = output_types;
-	//Initialize the arrays of values for each output type, fill them 
-	double** out= new double*[output_types];
+	//Initialize the matrix of values for each output type, fill it
+	matrix* out = (arena != NULL ? arena_matrix(arena, output_types, num_values, COL_MAJOR) : new matrix(output_types, num_values, COL_MAJOR));
+	const char* pos = min(header_end + 1, end);
 	for(int i = 0; i < num_values; i++){
-		fscanf(file_pointer, "%*d,"); // skip the first column containing set number
+		// skip the first column containing set number
+		pos = next_separator(pos, end);
+		if(pos < end && *pos == ',') pos++;
+		double* values = out->col(i);
 		for(int j = 0; j < output_types; j++){
-			if( i == 0){
-				out[j] = new double[num_values];
-			}
-			fscanf(file_pointer, "%lf,", out[j] + i);
+			const char* value_end = next_separator(pos, end);
 			//Check for infinity or nan
-			out[j][i] = check_num(out[j][i]);
-		}
-		if(i != num_values-1){
-			fscanf(file_pointer, "%*s\n");
+			values[j] = check_num(parse_double(pos, value_end));
+			//A line that is too short leaves the rest of its values empty instead of reading into the next line.
+			pos = value_end;
+			if(pos < end && *pos == ',') pos++;
 		}
+		//Skip whatever comes after the last value, e.g. PASSED.
+		const char* newline = (const char*)memchr(pos, '\n', end - pos);
+		pos = (newline == NULL ? end : newline + 1);
 	}
-	fclose(file_pointer);
+	unmap_file(data, size, mapped);
 	return out;
 }
 
+/*	Returns the first comma or newline in [pos, end), or end if there is none.
+	Where SSE2 is available the characters are compared 16 at a time, which makes splitting the long lines of the features files much cheaper than looking at one character at a time.
+*/
+const char* next_separator (const char* pos, const char* end) {
+#if defined(__SSE2__)
+	const __m128i comma = _mm_set1_epi8(',');
+	const __m128i newline = _mm_set1_epi8('\n');
+	for(; end - pos >= 16; pos += 16){
+		__m128i block = _mm_loadu_si128((const __m128i*)pos);
+		int found = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(block, comma), _mm_cmpeq_epi8(block, newline)));
+		if(found != 0){
+			return pos + __builtin_ctz(found);
+		}
+	}
+#endif
+	for(; pos < end && *pos != ',' && *pos != '\n'; pos++);
+	return pos;
+}
+
+/*	Converts the characters in [pos, end) to a double. std::from_chars is used where the standard library has it for floating point numbers, since it neither needs a terminated string nor looks at the locale.
+	Anything from_chars does not take whole (e.g. a leading '+' or out of range values) is converted by strtod, like fscanf did. Returns 0 if there is no number.
+*/
+double parse_double (const char* pos, const char* end) {
+#if defined(__cpp_lib_to_chars)
+	double value = 0;
+	from_chars_result result = from_chars(pos, end, value);
+	if(result.ec == errc() && result.ptr == end){
+		return value;
+	}
+#endif
+	//strtod needs a terminated string, and no number is longer than this.
+	char number[64];
+	size_t length = min((size_t)(end - pos), sizeof(number) - 1);
+	memcpy(number, pos, length);
+	number[length] = '\0';
+	return strtod(number, NULL);
+}
+
 /*	This function writes the sensitivity results to the file specified by file_name.
 	The first line of the file contains the same names that were taken from oscillation features file(s) that was made by deterministic.
 	The file contains a line for each simulation parameter, with a sensitviti
 */
-void write_sensitivity (int dims, int output_types, char** output_names, double** lsa_values, char* file_name) {
+void write_sensitivity (int dims, int output_types, char** output_names, matrix& lsa_values, char* file_name) {
 	ofstream file_out;
 	double x;
 	file_out.open(file_name);
@@ -184,7 +363,7 @@ void write_sensitivity (int dims, int output_types, char** output_names, double*
 	for (int i = 0; i < dims; i++ ){
 		file_out << "\n" << i << ',';
 		for ( int j = 0; j < output_types; j++ ){
-			x = (double)lsa_values[i][j];
+			x = lsa_values.at(i, j);
 			file_out << x << ",";
 		}
 	}
@@ -198,120 +377,884 @@ return;
 	The rest of the code is used for piping to/from the simulation.
 */
 
-/*	This funciton takes care of running the simulation by forking and executing (execv)
-by calling ../deterministic. The parameter sets are passed to child processes and the results of
-the simulations are passed back via a read/write pipe pair for each child.
-*/
-void simulate_samples (int first_dim, input_params& ip, sim_set& ss) {	
-    int* pipes[ip.processes];
-    if(!make_pipes(ip.processes, pipes)){
-    	ip.failure = copy_str("!!! Failure: could not pipe !!!\n");
-    	return;
-    }
-    char*** child_args = make_all_args(first_dim, ip, pipes);
-    
-    pid_t simpids[ip.processes];
-    for(int i = 0; i < ip.processes; i++){
-	    	simpids[i] = fork();
-    		if (simpids[i] == -1) {
-    			ip.failure = copy_str("!!! Failure: could not fork !!!\n");
-       		break;
-        }
-        //Child runs simulation.  
-		if (simpids[i] == 0) {
-			/*cout << "woopdedoo: "<< ip.sim_args << " ";
-			for(int woopdedoo = 0; woopdedoo < ip.sim_args_num; woopdedoo++){
-				cout << child_args[i][woopdedoo] << " ";
-			}
-			cout << endl;*/
-			if (-1 == execv(ip.sim_exec, child_args[i])){
-				const char* fail_prefix = "!!! Failure: could not exec ";
-				ip.failure = (char*)mallocate(sizeof(char)*(strlen(fail_prefix)+strlen(ip.sim_exec) + 5 + 1));
-				sprintf(ip.failure, "%s%s !!!\n", fail_prefix, ip.sim_exec);
-				break;
-			}
-		}   	
-    }  
-    if(ip.failure != NULL){
-    	del_args(ip.processes, ip.sim_args_num,child_args);
-		del_pipes(ip.processes, pipes, true);
-		return;  
-    }
-
-    // Parent gives sets and processes results. Writes params to simpipe[1], reads results from simpipe[0].
-    for(int i = 0; i < ip.processes; i++){
-		if(!(write_info(pipes[i][1], ss.dims, ss.sets_per_dim) && write_dim_sets(pipes[i][1], first_dim + i, ip.nominal, ss))){
-			ip.failure = copy_str("!!! Failure: could not write to pipe !!!");
-			ip.failcode = pipes[i][1];
-			break;
+/*	The simulations are run by a pool of ip.processes slots (see the sim_pool struct in io.hpp), which is shared by every nominal set of the run.
+	The scheduler in schedule.cpp hands out one job at a time with simulate_job() and collects finished jobs with wait_job(). A job is either the nominal set of a nominal_run or the perturbed sets of one of its dimensions.
+	By default every job is run by forking and executing (execv) the simulation program, e.g. ../deterministic. The parameter sets are passed to the child process via a read/write pipe pair and the results are written by the child into the features file named in its arguments.
+	With --persistent every slot is instead a worker that is started once by start_pool() and then streamed one job after another, see send_job().
+	With --binary-results the simulation is also asked to send its results back through its --pipe-out descriptor, which is then the write end of a separate result pipe. The results are sent as:
+		[int number of features F][F times: int length of the name, the name without a terminating '\0'][for every set: F doubles]
+	where the names are only sent with the first results of every simulation process. The results go straight into the output arrays of the nominal_run, without writing or parsing the features file.
+	A single simulation that exits without sending anything, or that sends F = 0, is assumed to have written the features file instead, so simulations that do not support binary results still work.
+*/
+
+/*	Makes the simulation pool and stores it in ip.pool. With --persistent this also starts the workers of the slots that are used at first (see first_limit() in resources.cpp).
+	Returns false (with ip.failure set) if any of the workers could not be started.
+*/
+bool start_pool (input_params& ip) {
+	ip.pool = new sim_pool(ip.processes, ip.persistent, ip.listen_port != 0);
+	ip.pool->limit = first_limit(ip);
+	ip.pool->auto_size = ip.auto_processes && !ip.plugin;
+	if(ip.pool->remote){
+		return open_listener(ip);
+	}
+	if(ip.plugin){
+		return open_plugin(ip);
+	}
+	//Single simulations are waited for with a timeout when they have deadlines. See wait_child().
+	if(ip.deadline != 0 && !ip.persistent && !ip.binary){
+		block_children(true);
+	}
+	if(ip.persistent){
+		//A worker that dies leaves its job pipe without a reader. Ignoring SIGPIPE turns writing to it into a failed write instead of killing this program.
+		signal(SIGPIPE, SIG_IGN);
+		for(; ip.pool->started < ip.pool->limit; ip.pool->started++){
+			if(!start_worker(ip, ip.pool->started)) return false;
 		}
 	}
-	if(ip.failure != NULL){
-    	del_args(ip.processes, ip.sim_args_num,child_args);
-		del_pipes(ip.processes, pipes, true);
-		return;  
-    }
-
-	//Loop for waiting on children and checking their exit status.		
-    for(int i = 0; i < ip.processes; i++){ 
-		int status = 0; 
-		waitpid(simpids[i], &status, WUNTRACED);
-		check_status(status, simpids[i], &ip.failcode, &(ip.failure));
-	}
-	//Children are done, so we know we can delete the argument array.
-	del_args(ip.processes, ip.sim_args_num,child_args);
-	del_pipes(ip.processes, pipes, true); 
-}
-
-//This function is very similar to the above, except that it is designed for only writing out only one parameter set -- the nominal parameter set.
-void simulate_nominal (input_params& ip) {
-	int* pipes = new int[2];
-	if (pipe(pipes) == -1) {
-		delete[] pipes;
-		ip.failure = copy_str("!!! Failure: could not pipe !!!\n");
+	return true;
+}
+
+/*	Waits for any job that is still running, shuts down persistent workers and frees ip.pool.
+*/
+void stop_pool (input_params& ip) {
+	if(ip.pool == NULL){
 		return;
 	}
-	char** child_args = (char**)mallocate(sizeof(char*)*ip.sim_args_num);
-	//make_arg(0, ip.sim_args_num, ip.random_seed, pipes, ip.data_dir, (char*)"nominal", ip.simulation_args, child_args);
-	make_arg(0, ip.sim_args_num, ip.random_seed, pipes, ip.data_dir, ip.nom_file, ip.simulation_args, child_args);
+	ip.pool->stopping = true;
+	while(wait_job(ip, NULL));
+	print_stragglers(ip);
+	close_plugin(ip);
+	if(ip.pool->remote){
+		close_listener(ip);
+	}
+	int code = SIM_JOB_SHUTDOWN;
+	for(int i = 0; i < ip.pool->count; i++){
+		sim_slot& slot = ip.pool->slot[i];
+		//Only a failure leaves a job whose in-memory file is still open.
+		if(slot.memfd != -1) close(slot.memfd);
+		if(slot.pid == 0) continue;
+		write(slot.job_fd, &code, sizeof(int));
+		close(slot.job_fd);
+		close(slot.result_fd);
+		int status = 0;
+		waitpid(slot.pid, &status, WUNTRACED);
+		if(ip.failure == NULL){
+			check_status(status, slot.pid, &ip.failcode, &(ip.failure));
+		}
+		del_arg(slot.args);
+	}
+	delete ip.pool;
+	ip.pool = NULL;
+}
+
+/*	Returns the index of a slot that can take a new job, or -1 if every slot is busy or as many jobs are running as the pool may run at once.
+*/
+int idle_slot (input_params& ip) {
+	int busy = 0;
+	for(int i = 0; i < ip.pool->count; i++){
+		busy += (ip.pool->slot[i].job != SLOT_IDLE);
+	}
+	if(busy >= ip.pool->limit){
+		return -1;
+	}
+	for(int i = 0; i < ip.pool->count; i++){
+		sim_slot& slot = ip.pool->slot[i];
+		if(slot.job != SLOT_IDLE) continue;
+		//A persistent worker that has died is not used again, and a remote worker has to be connected.
+		if(ip.pool->remote ? slot.job_fd == -1 : ip.pool->persistent && slot.pid == 0) continue;
+		return i;
+	}
+	return -1;
+}
+
+/*	Starts job (see sim_job) on an idle slot.
+	Returns true iff the job was started, otherwise ip.failure is set.
+*/
+bool simulate_job (input_params& ip, sim_job& job) {
+	int i = idle_slot(ip);
+	if(i == -1){
+		ip.failure = copy_str("!!! Failure: no simulation process is available !!!");
+		return false;
+	}
+	sim_slot& slot = ip.pool->slot[i];
+	nominal_run& run = *job.run;
+	//Every job, and the speculative copy of a late job (see deadline.cpp), writes its own in-memory file.
+	if(ip.memory_data && !open_memory_file(ip, job.dim, &slot.memfd)){
+		return false;
+	}
+	slot.run = &run;
+	slot.job = job.dim;
+	slot.span = job.span;
+	slot.first = job.first;
+	slot.sets = job.sets;
+	slot.stored = false;
+	bool started;
+	if(ip.pool->plugin != NULL){
+		double sending = stat_clock(ip);
+		started = send_plugin_job(ip, i);
+		stat_add(ip, &run, STAT_SEND, sending);
+	} else if(ip.pool->persistent){
+		started = send_job(ip, slot);
+	} else{
+		started = launch_job(ip, slot);
+	}
+	if(started){
+		slot.started = now_seconds();
+	} else{
+		slot.run = NULL;
+		slot.job = SLOT_IDLE;
+		if(ip.pool->remote){
+			//A remote worker that cannot be sent a job is gone, which does not fail the run: the job is started again on another worker, unless it was a copy whose job is still running.
+			mfree(ip.failure);
+			ip.failure = NULL;
+			ip.failcode = 0;
+			drop_worker(ip, i);
+			if(!slot.copy){
+				requeue_job(ip, job);
+			}
+		}
+	}
+	if(!started && slot.memfd != -1){
+		close(slot.memfd);
+		slot.memfd = -1;
+	}
+	return started;
+}
+
+/*	Waits until any running job finishes and frees up its slot.
+	Returns true and stores the job in *job (if job is not NULL), or returns false if no job is running. The job's in-memory file, if any, then belongs to *job (see collect_job()), and is closed if job is NULL.
+	If the job failed, ip.failure is set.
+*/
+bool wait_job (input_params& ip, sim_job* job) {
+	double waiting = stat_clock(ip);
+	double parsed = (ip.stats != NULL ? ip.stats->times[STAT_PARSE] : 0);
+	int i;
+	if(ip.pool->plugin != NULL){
+		i = wait_plugin(ip);
+	} else if(ip.pool->persistent || ip.binary){
+		i = wait_results(ip);
+	} else{
+		i = wait_child(ip);
+	}
+	//Binary results are read while waiting, which counts as parsing instead.
+	if(ip.stats != NULL){
+		waiting += ip.stats->times[STAT_PARSE] - parsed;
+	}
+	//The wait is counted for the nominal set whose job ended it. A cancelled job's set may be finished already.
+	stat_add(ip, (i == -1 || ip.pool->slot[i].cancelled ? NULL : ip.pool->slot[i].run), STAT_WAIT, waiting);
+	if(i == -1){
+		return false;
+	}
+	sim_slot& slot = ip.pool->slot[i];
+	//The results of a cancelled plugin job are thrown away, and only its slot is freed. See cancel_job() in deadline.cpp.
+	if(slot.cancelled){
+		slot.cancelled = false;
+		slot.run = NULL;
+		slot.job = SLOT_IDLE;
+		return false;
+	}
+	job_finished(ip, i);
+	record_job_cost(ip, slot);
+	stat_job(ip, *slot.run, slot.sets);
+	if(job != NULL){
+		*job = slot_job(slot);
+	} else if(slot.memfd != -1){
+		close(slot.memfd);
+	}
+	slot.memfd = -1;
+	slot.run = NULL;
+	slot.job = SLOT_IDLE;
+	resize_pool(ip, i);
+	return true;
+}
 
-    pid_t simpid;
-	simpid = fork();
+/*	Starts one simulation child for the job of slot and writes the job's parameter sets to it.
+	The pipe and argument array made for the child are kept in the slot so that they can be freed once the child exits.
+	Returns false (with ip.failure set) if the child could not be started.
+*/
+bool launch_job (input_params& ip, sim_slot& slot) {
+	nominal_run& run = *slot.run;
+	MEM_TAG(MEM_ARGS);
+	double spawning = stat_clock(ip);
+	int* pipes[1] = {NULL};
+	if(!make_pipes(1, pipes)){
+		ip.failure = copy_str("!!! Failure: could not pipe !!!\n");
+		return false;
+	}
+	//With binary results the child writes to its own result pipe, otherwise --pipe-out is the write end of the parameter pipe.
+	int child_pipes[2] = {pipes[0][0], pipes[0][1]};
+	int results[2] = {-1, -1};
+	if(ip.binary){
+		if(pipe(results) == -1){
+			del_pipes(1, pipes, true);
+			ip.failure = copy_str("!!! Failure: could not pipe !!!\n");
+			return false;
+		}
+		fcntl(results[0], F_SETFD, FD_CLOEXEC);
+		child_pipes[1] = results[1];
+	}
+	char* file_name = slot_file(ip, slot, 0);
+	char** child_args = make_arg(ip.sim_args_num, ip.random_seed, child_pipes, file_name, ip.simulation_args);
+	mfree(file_name);
+	
+	pid_t simpid = fork();
 	if (simpid == -1) {
 		ip.failure = copy_str("!!! Failure: could not fork !!!\n");
-		del_arg( ip.sim_args_num, child_args);
-		del_pipes(1, &pipes, true);
-		
-	}
-    //Child runs simulation.  
-	if (simpid == 0) {  
-		if (-1 == execv(ip.sim_exec, child_args)){
-			const char* fail_prefix = "!!! Failure: with nominal set, could not exec ";
-			ip.failure = (char*)mallocate(sizeof(char)*(strlen(fail_prefix)+strlen(ip.sim_exec) + 5 + 1));
-			sprintf(ip.failure, "%s%s !!!\n", fail_prefix, ip.sim_exec);
-			
-			del_arg( ip.sim_args_num, child_args);
-			del_pipes(1, &pipes, true);
-			return;  
-		}
-	}
-    // Parent gives sets and processes results. 
-	if(!write_nominal(ip, pipes[1])){
+		del_arg(child_args);
+		del_pipes(1, pipes, true);
+		if(ip.binary){
+			close(results[0]);
+			close(results[1]);
+		}
+		return false;
+	}
+	//Child runs simulation. If the exec fails the child exits with the failure status so that the parent's check_status() reports it.
+	if (simpid == 0) {
+		//The in-memory file of this job is the only one the child should inherit.
+		if(ip.memory_data){
+			fcntl(slot.memfd, F_SETFD, 0);
+		}
+		if(ip.deadline != 0){
+			block_children(false);
+		}
+		execv(ip.sim_exec, child_args);
+		cerr << "!!! Failure: could not exec " << ip.sim_exec << " !!!\n";
+		_exit(SIM_FAILURE_STATUS);
+	}
+	
+	// Parent gives sets and processes results. Writes params to the write end of the pipe, the child reads them from the read end.
+	slot.pid = simpid;
+	slot.pipes = pipes[0];
+	slot.args = child_args;
+	if(ip.binary){
+		close(results[1]);
+		slot.result_fd = results[0];
+		slot.received_len = 0;
+		slot.named = false;
+	}
+	stat_add(ip, &run, STAT_SPAWN, spawning);
+	sim_job job = slot_job(slot);
+	if(!write_job_sets(ip, pipes[0][1], job)){
+		ip.failure = copy_str("!!! Failure: could not write to pipe !!!");
+		ip.failcode = pipes[0][1];
+	}
+	//The job is marked as started even if writing failed, because the child still has to be waited on.
+	return true;
+}
+
+/*	Waits for whichever simulation child finishes first, checks its exit status and frees its pipe and arguments.
+	Returns the index of its slot, or -1 if no child is running or the next running job became late first (see deadline_timeout() in deadline.cpp).
+*/
+int wait_child (input_params& ip) {
+	for(;;){
+		int status = 0;
+		int timeout = deadline_timeout(ip);
+		struct rusage usage;
+		pid_t done = wait4(-1, &status, WUNTRACED | (timeout == -1 ? 0 : WNOHANG), &usage);
+		//No child has exited yet, so wait for SIGCHLD (which is blocked, see start_pool()) until the next deadline.
+		if(done == 0){
+			sigset_t children;
+			sigemptyset(&children);
+			sigaddset(&children, SIGCHLD);
+			struct timespec wait_for = {timeout / 1000, (timeout % 1000) * 1000000L};
+			if(sigtimedwait(&children, NULL, &wait_for) == -1 && errno == EAGAIN){
+				return -1;
+			}
+			continue;
+		}
+		if(done == -1){
+			if(errno == EINTR) continue;
+			return -1;
+		}
+		for(int i = 0; i < ip.pool->count; i++){
+			sim_slot& slot = ip.pool->slot[i];
+			if(slot.pid != done || slot.job == SLOT_IDLE) continue;
+			check_status(status, done, &ip.failcode, &(ip.failure));
+			slot.peak_rss = usage.ru_maxrss;
+			del_arg(slot.args);
+			del_pipes(1, &slot.pipes, true);
+			slot.args = NULL;
+			slot.pipes = NULL;
+			slot.pid = 0;
+			return i;
+		}
+	}
+}
+
+/*	Writes the parameter sets of job to fd: the nominal set if its dim is JOB_NOMINAL, otherwise the perturbed sets of its dimensions that plan_job() chose, one dimension after another.
+	To the simulation a job of several dimensions is just more sets, so it is written like the job of one dimension.
+*/
+bool write_job_sets (input_params& ip, int fd, sim_job& job) {
+	nominal_run& run = *job.run;
+	double sending = stat_clock(ip);
+	bool written;
+	if(job.dim == JOB_NOMINAL){
+		written = write_nominal(fd, ip.dims, run.nominal);
+	} else{
+		written = write_info(fd, run.ss->dims, job.sets);
+		for(int dim = job.dim; dim < job.dim + job.span && written; dim++){
+			int sets = (job.span == 1 ? job.sets : job_sets(run, dim));
+			if(run.ss->trajectories != NULL){
+				written = write_trajectory_sets(fd, *run.ss, dim, run.job_columns(dim) + job.first, sets);
+			} else{
+				written = write_dim_sets(fd, dim, run.nominal, *run.ss, run.job_columns(dim) + job.first, sets);
+			}
+		}
+	}
+	stat_add(ip, &run, STAT_SEND, sending);
+	return written;
+}
+
+/*	The following functions run the simulations on persistent workers (--persistent) instead of forking a new simulation for every job.
+	Each worker is started once per run with the usual arguments plus "--stream-jobs" and is then kept alive across all nominal sets, so the cost of starting the simulation program and initializing the model is only paid once per worker.
+	Jobs are framed on the worker's --pipe-in descriptor as:
+		[int SIM_JOB_NEXT][int length of the file name][the file name, without a terminating '\0'][the same bytes write_info() and write_dim_sets() send to a single simulation]
+	or [int SIM_JOB_SHUTDOWN], after which the worker should exit. The file name replaces the --print-osc-features argument for that one job.
+	After every job the worker writes one int on its --pipe-out descriptor, which is 0 if the job succeeded and any other value if it failed. 
+	Unlike single simulations, the --pipe-out descriptor of a worker is the write end of its own result pipe, not the pipe the jobs are read from.
+	A worker that finds its job pipe closed (e.g. because this program exited after an error) should exit as if it had been sent SIM_JOB_SHUTDOWN.
+*/
+
+/*	Starts the worker for slot i of ip.pool. Returns false (with ip.failure set) if it could not be started.
+*/
+bool start_worker (input_params& ip, int i) {
+	MEM_TAG(MEM_ARGS);
+	double spawning = stat_clock(ip);
+	sim_slot& w = ip.pool->slot[i];
+	int jobs[2];
+	int results[2];
+	if(pipe(jobs) == -1){
+		ip.failure = copy_str("!!! Failure: could not pipe !!!\n");
+		return false;
+	}
+	if(pipe(results) == -1){
+		close(jobs[0]);
+		close(jobs[1]);
+		ip.failure = copy_str("!!! Failure: could not pipe !!!\n");
+		return false;
+	}
+	//The ends the parent keeps must not leak into workers that are started later, otherwise a worker would not see its job pipe close when this program exits.
+	fcntl(jobs[1], F_SETFD, FD_CLOEXEC);
+	fcntl(results[0], F_SETFD, FD_CLOEXEC);
+	int worker_pipes[2] = {jobs[0], results[1]};
+	char* file_name = make_name(ip.data_dir, (char*)"worker_", i);
+	w.args = make_arg(ip.sim_args_num, ip.random_seed, worker_pipes, file_name, ip.simulation_args);
+	mfree(file_name);
+	
+	w.pid = fork();
+	if(w.pid == -1){
+		w.pid = 0;
+		ip.failure = copy_str("!!! Failure: could not fork !!!\n");
+	}
+	//Child becomes the worker.
+	if(w.pid == 0 && ip.failure == NULL){
+		signal(SIGPIPE, SIG_DFL);
+		execv(ip.sim_exec, w.args);
+		cerr << "!!! Failure: could not exec " << ip.sim_exec << " !!!\n";
+		_exit(SIM_FAILURE_STATUS);
+	}
+	close(jobs[0]);
+	close(results[1]);
+	if(ip.failure != NULL){
+		close(jobs[1]);
+		close(results[0]);
+		del_arg(w.args);
+		w.args = NULL;
+		return false;
+	}
+	w.job_fd = jobs[1];
+	w.result_fd = results[0];
+	//A worker that replaces one that was killed (see cancel_job() in deadline.cpp) sends the names of the features again.
+	w.named = false;
+	stat_add(ip, NULL, STAT_SPAWN, spawning);
+	return true;
+}
+
+/*	Writes the job of slot w to its worker. Returns true iff the whole job was written.
+*/
+bool send_job (input_params& ip, sim_slot& w) {
+	//A worker was started before the job's in-memory file was made, so it has to open it through this process's descriptor table.
+	char* file_name = slot_file(ip, w, getpid());
+	int header[2] = {SIM_JOB_NEXT, (int)strlen(file_name)};
+	bool good_write = (int)sizeof(header) == write(w.job_fd, header, sizeof(header));
+	good_write = good_write && header[1] == write(w.job_fd, file_name, header[1]);
+	mfree(file_name);
+	sim_job job = slot_job(w);
+	good_write = good_write && write_job_sets(ip, w.job_fd, job);
+	if(!good_write){
 		ip.failure = copy_str("!!! Failure: could not write to pipe !!!");
-		ip.failcode = pipes[1];
-    	del_arg( ip.sim_args_num, child_args);
-		del_pipes(1, &pipes, true);
-		return;  
-    }
-
-	//Waiting on child and checking their exit status.		
-	int status; 
-	waitpid(simpid, &status, WUNTRACED);
-	check_status(status, simpid, &ip.failcode, &(ip.failure));
-	//Children are done, so we know we can delete the argument array.
-	del_arg( ip.sim_args_num, child_args);
-	del_pipes(1, &pipes, true);
-	return;
+		ip.failcode = w.job_fd;
+		return false;
+	}
+	w.received_len = 0;
+	return true;
+}
+
+/*	Waits until the results of one of the running jobs are complete. This is used for persistent workers and for single simulations with --binary-results, whose results have to be read while they run so that a full pipe never blocks them.
+	A single simulation's results are complete when it closes the result pipe by exiting, and a worker's when it has sent its status and, with --binary-results, the results of the job.
+	Returns the index of the slot whose job finished, or -1 if no job is running or waiting failed. If the job failed, or the worker died, ip.failure is set.
+*/
+int wait_results (input_params& ip) {
+	int count = ip.pool->count;
+	//A coordinator also waits for workers to connect on the last descriptor, and for idle workers to disconnect.
+	struct pollfd fds[count + 1];
+	int busy = 0;
+	for(int i = 0; i < count; i++){
+		sim_slot& slot = ip.pool->slot[i];
+		fds[i].fd = (slot.job != SLOT_IDLE || ip.pool->remote ? slot.result_fd : -1);
+		fds[i].events = POLLIN;
+		fds[i].revents = 0;
+		if(slot.job != SLOT_IDLE) busy++;
+	}
+	fds[count].fd = (ip.pool->stopping ? -1 : ip.pool->listen_fd);
+	fds[count].events = POLLIN;
+	fds[count].revents = 0;
+	//Without a running job there is nothing to wait for, unless a coordinator has no worker to start the next job on.
+	if(busy == 0 && (!ip.pool->remote || ip.pool->stopping || idle_slot(ip) != -1)){
+		return -1;
+	}
+	while(true){
+		//With deadlines, waiting stops when the next running job becomes late. See deadline.cpp.
+		int ready;
+		while((ready = poll(fds, count + 1, deadline_timeout(ip))) == -1){
+			if(errno != EINTR) return -1;
+		}
+		if(ready == 0){
+			return -1;
+		}
+		//A new worker can take the next job right away.
+		if(fds[count].revents != 0 && accept_worker(ip)){
+			return -1;
+		}
+		fds[count].revents = 0;
+		for(int i = 0; i < count; i++){
+			if(fds[i].revents == 0) continue;
+			fds[i].revents = 0;
+			sim_slot& w = ip.pool->slot[i];
+			//Make room for at least one more pipe's worth of results.
+			if(w.received_size - w.received_len < RESULT_CHUNK){
+				char* grown = new char[w.received_size + 2*RESULT_CHUNK];
+				if(w.received != NULL){
+					memcpy(grown, w.received, w.received_len);
+					delete[] w.received;
+				}
+				w.received = grown;
+				w.received_size += 2*RESULT_CHUNK;
+			}
+			int got = read(w.result_fd, w.received + w.received_len, w.received_size - w.received_len);
+			if(got == -1 && errno == EINTR) continue;
+			if(ip.pool->remote && (got <= 0 || w.job == SLOT_IDLE)){
+				//The worker is gone (or sent something without having a job), so its job goes to another worker.
+				drop_worker(ip, i);
+				return -1;
+			}
+			if(got <= 0 && !ip.pool->persistent){
+				finish_child(ip, w);
+				return i;
+			} else if(got <= 0){
+				//The worker closed its result pipe, so it must have exited.
+				int status = 0;
+				waitpid(w.pid, &status, WUNTRACED);
+				if(check_status(status, w.pid, &ip.failcode, &(ip.failure))){
+					ip.failure = copy_str("!!! Failure: worker exited before finishing its job !!!");
+					ip.failcode = w.pid;
+				}
+				close(w.job_fd);
+				close(w.result_fd);
+				w.job_fd = -1;
+				w.result_fd = -1;
+				del_arg(w.args);
+				w.args = NULL;
+				w.pid = 0;
+				return i;
+			}
+			w.received_len += got;
+			if(!ip.pool->persistent) continue;
+			int size = results_size(ip, w);
+			if(size == -1 || w.received_len < size) continue;
+			int result = 0;
+			memcpy(&result, w.received, sizeof(int));
+			if(result != 0){
+				ip.failure = copy_str("!!! Failure: worker could not simulate its job !!!");
+				ip.failcode = result;
+			} else if(ip.binary){
+				double parsing = stat_clock(ip);
+				store_results(ip, w, sizeof(int));
+				stat_add(ip, w.run, STAT_PARSE, parsing);
+			}
+			if(ip.pool->auto_size){
+				w.peak_rss = worker_peak_rss(w.pid);
+			}
+			return i;
+		}
+	}
+}
+
+/*	Finishes a single simulation with --binary-results whose result pipe has been closed: waits for it to exit, checks its exit status, frees its pipes and arguments and stores the results it sent, if any.
+	Returns false if the simulation failed.
+*/
+bool finish_child (input_params& ip, sim_slot& slot) {
+	close(slot.result_fd);
+	slot.result_fd = -1;
+	int status = 0;
+	struct rusage usage;
+	usage.ru_maxrss = 0;
+	wait4(slot.pid, &status, WUNTRACED, &usage);
+	slot.peak_rss = usage.ru_maxrss;
+	bool good = check_status(status, slot.pid, &ip.failcode, &(ip.failure));
+	del_arg(slot.args);
+	del_pipes(1, &slot.pipes, true);
+	slot.args = NULL;
+	slot.pipes = NULL;
+	slot.pid = 0;
+	if(good && slot.received_len > 0){
+		int size = results_size(ip, slot);
+		if(size == -1 || slot.received_len < size){
+			ip.failure = copy_str("!!! Failure: simulation sent incomplete results !!!");
+			ip.failcode = slot.received_len;
+			return false;
+		}
+		double parsing = stat_clock(ip);
+		bool stored = store_results(ip, slot, 0);
+		stat_add(ip, slot.run, STAT_PARSE, parsing);
+		return stored;
+	}
+	return good;
+}
+
+/*	The following functions store the results of finished jobs in their nominal_run, where the analysis picks them up.
+*/
+
+//Returns the number of parameter sets that job dim of run simulates.
+int job_sets (nominal_run& run, int dim) {
+	return run.job_count[dim + 1];
+}
+
+/*	Decides which parameter sets job dim of run simulates: the nominal set if dim is JOB_NOMINAL, otherwise the perturbed sets of dimension dim, or only the sets of the rings it has not simulated yet if run.adaptive (see add_rings() in init.hpp).
+	Sets that are the same as another set of the dimension are left out and get its results from share_output(), and a dimension whose nominal value is 0 is not simulated at all (see share_sets() in init.hpp).
+	With --cache-dir, the sets whose results are already in the cache are filled in from it and left out of the job (see lookup_job() in cache.cpp).
+	Returns the number of sets that have to be simulated, which is 0 if the job does not need to be started at all.
+*/
+int plan_job (input_params& ip, nominal_run& run, int dim) {
+	if(dim == JOB_NOMINAL){
+		run.job_count[0] = 1;
+	} else{
+		int* columns = run.job_columns(dim);
+		int* copies = run.copies + dim * run.ss->sets_per_dim;
+		int count = 0;
+		for(int i = 0; i < run.ss->sets_per_dim && !run.constant[dim]; i++){
+			if(copies[i] == -1 && (!run.adaptive || (run.ring_of(i) >= run.first_ring[dim] && run.ring_of(i) <= run.rings[dim]))){
+				columns[count++] = i;
+			}
+		}
+		run.job_count[dim + 1] = count;
+	}
+	if(ip.resume){
+		resume_job(ip, run, dim);
+	}
+	if(ip.cache_dir != NULL){
+		lookup_job(ip, run, dim);
+	}
+	return job_sets(run, dim);
+}
+
+//Returns the job of every set that plan_job() chose for job dim of run.
+sim_job whole_job (nominal_run& run, int dim) {
+	sim_job job;
+	job.run = &run;
+	job.dim = dim;
+	job.span = 1;
+	job.first = 0;
+	job.sets = job_sets(run, dim);
+	job.memfd = -1;
+	job.stored = false;
+	return job;
+}
+
+//Returns the job running on slot.
+sim_job slot_job (sim_slot& slot) {
+	sim_job job;
+	job.run = slot.run;
+	job.dim = slot.job;
+	job.span = slot.span;
+	job.first = slot.first;
+	job.sets = slot.sets;
+	job.memfd = slot.memfd;
+	job.stored = slot.stored;
+	return job;
+}
+
+/*	Copies the results of the sets of dimension dim of run that share them with another set (see share_sets() in init.hpp) once the results of that set are in, which is at the latest when the job of its ring has finished.
+*/
+void share_output (nominal_run& run, int dim) {
+	if(dim == JOB_NOMINAL || run.dim_output[dim] == NULL){
+		return;
+	}
+	int* copies = run.copies + dim * run.ss->sets_per_dim;
+	matrix& output = *run.dim_output[dim];
+	for(int i = 0; i < run.ss->sets_per_dim; i++){
+		if(copies[i] != -1 && run.ring_of(i) <= run.rings[dim]){
+			memcpy(output.col(i), output.col(copies[i]), sizeof(double)*output.rows);
+		}
+	}
+}
+
+/*	Returns the (mallocated) name of the features file that job writes, which is named after its (first) dimension, followed by "_" and its first set if it is part of a split dimension.
+	With --memory-data this is the path of the job's in-memory file in the /proc descriptor table of this process.
+*/
+char* job_file (input_params& ip, sim_job& job) {
+	nominal_run& run = *job.run;
+	if(ip.memory_data){
+		char* name = (char*)mallocate(sizeof(char)*64);
+		sprintf(name, "/proc/self/fd/%d", job.memfd);
+		return name;
+	}
+	if(job.dim == JOB_NOMINAL){
+		return make_name(run.dir, ip.nom_file, 0);
+	}
+	char* name = make_name(run.dir, ip.dim_file, job.dim);
+	if(job.first > 0){
+		char* piece = (char*)mallocate(sizeof(char)*(strlen(name) + 1 + len_num(job.first) + 1));
+		sprintf(piece, "%s_%d", name, job.first);
+		mfree(name);
+		name = piece;
+	}
+	return name;
+}
+
+/*	Returns the (mallocated) name of the features file the job running on slot writes, which is the job's file (see job_file()) unless the job is the speculative copy of a late job (see deadline.cpp), which writes to the job's file followed by ".copy".
+	With --memory-data every job writes its own in-memory file, whose path is taken from the /proc descriptor table of process owner, or of whichever process opens it if owner is 0.
+*/
+char* slot_file (input_params& ip, sim_slot& slot, pid_t owner) {
+	if(ip.memory_data){
+		char* name = (char*)mallocate(sizeof(char)*64);
+		if(owner == 0){
+			sprintf(name, "/proc/self/fd/%d", slot.memfd);
+		} else{
+			sprintf(name, "/proc/%d/fd/%d", (int)owner, slot.memfd);
+		}
+		return name;
+	}
+	sim_job job = slot_job(slot);
+	char* file_name = job_file(ip, job);
+	if(!slot.copy){
+		return file_name;
+	}
+	char* name = (char*)mallocate(sizeof(char)*(strlen(file_name) + strlen(".copy") + 1));
+	sprintf(name, "%s.copy", file_name);
+	mfree(file_name);
+	return name;
+}
+
+/*	With --memory-data the features file of every job is an anonymous in-memory file instead of a file in the data directory, so the simulation data never touches the disk.
+	The file is made with memfd_create() where it is available, otherwise it is a file in /dev/shm that is unlinked right away. Its descriptor is stored in *memfd, which is the slot's until the job finishes and the job's until its results have been read.
+	Returns false (with ip.failure set) if the file could not be made.
+*/
+bool open_memory_file (input_params& ip, int dim, int* memfd) {
+	int fd;
+	#if defined(MFD_CLOEXEC)
+		fd = memfd_create(dim == JOB_NOMINAL ? ip.nom_file : ip.dim_file, MFD_CLOEXEC);
+	#else
+		char shm_name[] = "/dev/shm/sensitivity-XXXXXX";
+		fd = mkstemp(shm_name);
+		if(fd != -1){
+			unlink(shm_name);
+			fcntl(fd, F_SETFD, FD_CLOEXEC);
+		}
+	#endif
+	if(fd == -1){
+		ip.failure = copy_str("!!! Failure: could not make an in-memory data file !!!");
+		ip.failcode = errno;
+		return false;
+	}
+	*memfd = fd;
+	return true;
+}
+
+//Releases the in-memory file of job, if it has one.
+void close_memory_file (sim_job& job) {
+	if(job.memfd != -1){
+		close(job.memfd);
+		job.memfd = -1;
+	}
+}
+
+/*	Makes sure the results of the finished job are stored in its nominal_run. Results that were not sent back through the result pipe are read from the job's features file, which is then deleted if ip.delete_data is set.
+	Returns false (with ip.failure set) if the results could not be read.
+*/
+bool collect_job (input_params& ip, sim_job& job) {
+	if(job.stored){
+		close_memory_file(job);
+		return true;
+	}
+	nominal_run& run = *job.run;
+	int num_dependent = 0;
+	char* file_name = job_file(ip, job);
+	char** output_names = NULL;
+	double parsing = stat_clock(ip);
+	matrix* output = load_output(job.sets, &num_dependent, file_name, (job.dim == JOB_NOMINAL ? &output_names : NULL), &ip.layout, run.arena);
+	stat_add(ip, &run, STAT_PARSE, parsing);
+	if(output == NULL){
+		const char* fail_prefix = "!!! Failure: could not read the simulation output file ";
+		ip.failure = (char*)mallocate(sizeof(char)*(strlen(fail_prefix) + strlen(file_name) + 5 + 1));
+		sprintf(ip.failure, "%s%s !!!\n", fail_prefix, file_name);
+		mfree(file_name);
+		close_memory_file(job);
+		return false;
+	}
+	//Deletes the features file if ip.delete_data is true. An in-memory file is always released once it has been read.
+	if(ip.memory_data){
+		close_memory_file(job);
+	} else{
+		unmake_file(file_name, ip.delete_data);
+	}
+	mfree(file_name);
+	if(job.dim == JOB_NOMINAL){
+		run.output_names = output_names;
+	}
+	return store_output(ip, job, output, num_dependent);
+}
+
+/*	Stores output (a features x sets matrix from the arena of its nominal_run), the output features of job. Every job of a nominal set has to have the same number of features.
+	The sets of every dimension of the job are copied into their columns (see plan_job()) of the dimension's features x sets_per_dim matrix, unless the job simulated every perturbed set of its only dimension. For an adaptive dimension this keeps the rings simulated so far in the middle columns.
+	Returns false (with ip.failure set) if the number of features does not match.
+*/
+bool store_output (input_params& ip, sim_job& job, matrix* output, int num_dependent) {
+	MEM_TAG(MEM_RESULTS);
+	nominal_run& run = *job.run;
+	if(run.num_features == -1){
+		run.num_features = num_dependent;
+	} else if(run.num_features != num_dependent){
+		ip.failure = copy_str("!!! Failure: simulations of one nominal set returned different numbers of features !!!");
+		ip.failcode = num_dependent;
+		return false;
+	}
+	job.stored = true;
+	if(job.dim == JOB_NOMINAL){
+		run.nominal_output = output;
+		return true;
+	}
+	if(job.span == 1 && job.first == 0 && run.dim_output[job.dim] == NULL && output->cols == run.ss->sets_per_dim){
+		run.dim_output[job.dim] = output;
+		return true;
+	}
+	int column = 0;
+	for(int dim = job.dim; dim < job.dim + job.span; dim++){
+		int sets = (job.span == 1 ? job.sets : job_sets(run, dim));
+		if(run.dim_output[dim] == NULL){
+			run.dim_output[dim] = arena_matrix(run.arena, num_dependent, run.ss->sets_per_dim, COL_MAJOR);
+		}
+		int* columns = run.job_columns(dim) + job.first;
+		for(int i = 0; i < sets; i++){
+			memcpy(run.dim_output[dim]->col(columns[i]), output->col(column + i), sizeof(double)*num_dependent);
+		}
+		column += sets;
+	}
+	return true;
+}
+
+/*	Returns how many bytes the results of the job running on slot take up in total, or -1 if not enough of them have been received to tell.
+	For persistent workers this includes the status int that comes first.
+*/
+int results_size (input_params& ip, sim_slot& slot) {
+	int pos = 0;
+	int value = 0;
+	if(ip.pool->persistent){
+		if(slot.received_len < (int)sizeof(int)) return -1;
+		memcpy(&value, slot.received, sizeof(int));
+		pos += sizeof(int);
+		if(value != 0 || !ip.binary) return pos;
+	}
+	if(slot.received_len < pos + (int)sizeof(int)) return -1;
+	int features = 0;
+	memcpy(&features, slot.received + pos, sizeof(int));
+	pos += sizeof(int);
+	if(features <= 0) return pos;
+	if(!slot.named){
+		for(int j = 0; j < features; j++){
+			if(slot.received_len < pos + (int)sizeof(int)) return -1;
+			memcpy(&value, slot.received + pos, sizeof(int));
+			pos += sizeof(int) + value;
+		}
+	}
+	return pos + slot.sets*features*sizeof(double);
+}
+
+/*	Stores the binary results received on slot, starting at byte pos, in the slot's nominal_run.
+	The first names that are received are kept in ip.pool, and every nominal set takes a copy of them with its nominal results.
+	A feature count of 0 means the simulation wrote the features file instead, which collect_job() then reads.
+	Returns false (with ip.failure set) if the results could not be stored.
+*/
+bool store_results (input_params& ip, sim_slot& slot, int pos) {
+	MEM_TAG(MEM_RESULTS);
+	nominal_run& run = *slot.run;
+	int features = 0;
+	memcpy(&features, slot.received + pos, sizeof(int));
+	pos += sizeof(int);
+	if(features <= 0){
+		return true;
+	}
+	//Ensure that at most MAX_NUM_FEATS features are used for the rest of the processing, as load_output() does.
+	int output_types = min(features, MAX_NUM_FEATS);
+	if(!slot.named){
+		bool keep = (ip.pool->names == NULL);
+		if(keep){
+			ip.pool->names = new char*[output_types];
+			ip.pool->num_features = output_types;
+		}
+		for(int j = 0; j < features; j++){
+			int length = 0;
+			memcpy(&length, slot.received + pos, sizeof(int));
+			pos += sizeof(int);
+			if(keep && j < output_types){
+				ip.pool->names[j] = new char[length + 1];
+				memcpy(ip.pool->names[j], slot.received + pos, length);
+				ip.pool->names[j][length] = '\0';
+			}
+			pos += length;
+		}
+		slot.named = true;
+	}
+	if(ip.pool->names == NULL || ip.pool->num_features != output_types){
+		ip.failure = copy_str("!!! Failure: simulation sent results without the names of their features !!!");
+		ip.failcode = features;
+		return false;
+	}
+	int sets = slot.sets;
+	//The values are sent one set after another, which is the layout of the matrix, so every set is copied in whole.
+	matrix* output = arena_matrix(run.arena, output_types, sets, COL_MAJOR);
+	for(int i = 0; i < sets; i++){
+		double* values = output->col(i);
+		memcpy(values, slot.received + pos + i*features*sizeof(double), output_types*sizeof(double));
+		for(int j = 0; j < output_types; j++){
+			//Check for infinity or nan
+			values[j] = check_num(values[j]);
+		}
+	}
+	if(slot.job == JOB_NOMINAL){
+		copy_names(ip, run, output_types);
+	}
+	sim_job job = slot_job(slot);
+	bool stored = store_output(ip, job, output, output_types);
+	slot.stored = job.stored;
+	return stored;
+}
+
+/*	Gives run a copy of the names of its features features, which ip.pool keeps from the first results that were sent.
+*/
+void copy_names (input_params& ip, nominal_run& run, int features) {
+	run.output_names = arena_names(run.arena, ip.pool->names, features);
+}
+
+/*	Returns a copy of the first features names in names, allocated from arena.
+*/
+char** arena_names (mem_arena* arena, char** names, int features) {
+	char** copy = (char**)arena_alloc(arena, sizeof(char*)*features);
+	for(int j = 0; j < features; j++){
+		copy[j] = (char*)arena_alloc(arena, strlen(names[j]) + 1);
+		strcpy(copy[j], names[j]);
+	}
+	return copy;
 }
 
 /*	This function establishes a communication pipe from the parent to each simulation child for the passing of parameter sets and results.
@@ -337,38 +1280,49 @@ void del_pipes (int processes, int** pipes, bool close_write) {
 	}
 } 
 
-/*	mallocates an array of char** that are needed for passing arguments to the execv call for each child simulation. 
-	It fills in the appropriate argument space with the file descriptor of the pipe the children will read/write with.
-	make_arg is just a sub-function that handles the work for one argument. */
-char*** make_all_args (int first_dim, input_params& ip,int** pipes) {
-	char*** child_args = (char***)mallocate(sizeof(char**)*ip.processes);
-	for(int i = 0; i < ip.processes; i++){
-		child_args[i] = (char**)mallocate(sizeof(char*)*ip.sim_args_num);
-		make_arg(first_dim+i, ip.sim_args_num, ip.random_seed, pipes[i], ip.data_dir, ip.dim_file, ip.simulation_args, child_args[i]);
-	}
-	return child_args;
-}
-void make_arg (int dim_num, int sim_args_num, int seed, int* pipes, char* dir_name, char* dim_name, char** simulation_args, char** destination) {
+/*	mallocates the array of char* that is needed for passing arguments to the execv call for one child simulation. 
+	It fills in the appropriate argument space with the file descriptor of the pipe the child will read/write with.
+	The array and all of its strings are allocated in one block, which del_arg() frees. */
+char** make_arg (int sim_args_num, int seed, int* pipes, char* file_name, char** simulation_args) {
+	//The numbers are written into fixed places after the array, which are long enough for any int.
+	char numbers[3][12];
 	int pipe_loc = 0;
-	int strlen_num;	
+	size_t length = sizeof(char*)*sim_args_num;
 	for(int j = 0; j < sim_args_num; j++){
 		if(j == 2 || j == 4){
-			strlen_num = len_num( pipes[pipe_loc] );
-			destination[j]= (char*)mallocate(sizeof(char)*(strlen_num+1));
-			sprintf(destination[j], "%d", pipes[pipe_loc]);
+			sprintf(numbers[pipe_loc], "%d", pipes[pipe_loc]);
+			length += strlen(numbers[pipe_loc]) + 1;
 			pipe_loc++;
 		} else if(j == 6){
-			destination[j] = make_name(dir_name, dim_name, dim_num);  
-		} else if(j== 8){
-			strlen_num = len_num( seed );
-			destination[j]= (char*)mallocate(sizeof(char)*(strlen_num+1));
-			sprintf(destination[j], "%d", seed);
-		}else if (simulation_args[j] == NULL){
+			length += strlen(file_name) + 1;
+		} else if(j == 8){
+			sprintf(numbers[2], "%d", seed);
+			length += strlen(numbers[2]) + 1;
+		} else if(simulation_args[j] != NULL){
+			length += strlen(simulation_args[j]) + 1;
+		}
+	}
+	char** destination = (char**)mallocate(length);
+	char* pos = (char*)(destination + sim_args_num);
+	pipe_loc = 0;
+	for(int j = 0; j < sim_args_num; j++){
+		const char* arg = simulation_args[j];
+		if(j == 2 || j == 4){
+			arg = numbers[pipe_loc++];
+		} else if(j == 6){
+			arg = file_name;
+		} else if(j == 8){
+			arg = numbers[2];
+		}
+		if(arg == NULL){
 			destination[j] = NULL;
 		} else{
-			destination[j] = copy_str((const char*) simulation_args[j]);
+			destination[j] = pos;
+			strcpy(pos, arg);
+			pos += strlen(arg) + 1;
 		}
 	}
+	return destination;
 }
 
 /* This mallocates a string that can fit a full directory path, file name, and an integer for uniqe identification of the file. It then sprintf's to fill in the correct characters.*/
@@ -385,18 +1339,8 @@ char* make_name (char* dir, char* file, int num) {
 	return name;
 }
 
-/*	Deleting the arguments that were used.*/
-void del_args (int processes, int sim_args_num, char*** child_args) {
-	for(int i = 0; i < processes; i++){
-		del_arg(sim_args_num, child_args[i]);
-	}
-	mfree(child_args);
-}
-void del_arg(int sim_args_num, char** arg){
-	for(int j = 0; j < sim_args_num; j++){
-		if(arg[j] != NULL)
-			mfree(arg[j]);	
-		}
+/*	Deleting the arguments that were used, which make_arg() allocated in one block.*/
+void del_arg(char** arg){
 	mfree(arg);
 }
 
@@ -417,7 +1361,7 @@ void segs_per_sim (int segments, int processes, int* distribution) {
 	The "#ifdef WCOREDUMP" is necessary to check whether the OS running the program has an implementation for checking for core dumps.
 */
 bool check_status (int status, int simpid, int* failcode, char** failure) {
-	if(WIFEXITED(status) && WEXITSTATUS(status) != 6){
+	if(WIFEXITED(status) && WEXITSTATUS(status) != SIM_FAILURE_STATUS){
 		cout << "Child (" << simpid << ") exited properly with status: " << WEXITSTATUS(status) << "\n";
 		return true;	
 	} else{
@@ -470,13 +1414,14 @@ bool write_info (int fd, int dims, int sets_per_dim) {
 
 /*	After the necessary information has been sent to the simulation program, this function writes a byte stream to the pipe (fd) that contains the double values to use as simulation parameters.
 	The format in which the simulations reads and stores these values is determined by the integers it received from write_info() and the structure of the simulation program itself.
+	Only the count perturbed sets of dimension dim in columns are written, in that order.
 */
-bool write_dim_sets (int fd, int dim, double* nominal, sim_set& ss) {
+bool write_dim_sets (int fd, int dim, double* nominal, sim_set& ss, int* columns, int count) {
 	double nom_hold = nominal[dim];
-	double* inserts = ss.dim_sets[dim];
+	double* inserts = ss.dim_sets->row(dim);
 	bool good_write = true;
-	for(int i = 0; i < ss.sets_per_dim; i++){
-		nominal[dim] = inserts[i];
+	for(int i = 0; i < count; i++){
+		nominal[dim] = inserts[columns[i]];
 		/*cout << "\n#Dimension " << dim << " Gets sets: \n";
 		for(int check = 0; check < ss.dims; check++){
 			cout << nominal[check] << ", ";
@@ -489,10 +1434,21 @@ bool write_dim_sets (int fd, int dim, double* nominal, sim_set& ss) {
 	return good_write;
 }
 
-/*	This function wraps write_info() and write_dim_sets() together for the simple case of writing only the nominal parameter set. 
+/*	Writes the parameter sets of trajectory trajectory of ss (see morris.cpp) in the given count columns to fd.
 */
-bool write_nominal (input_params& ip, int fd) {
-	if(!write_info(fd, ip.dims, 1)) return false;
-	return ((int)sizeof(double)*ip.dims == write(fd, ip.nominal, sizeof(double)*ip.dims) );
+bool write_trajectory_sets (int fd, sim_set& ss, int trajectory, int* columns, int count) {
+	for(int i = 0; i < count; i++){
+		double* params = ss.trajectories->row(trajectory * ss.sets_per_dim + columns[i]);
+		if((int)sizeof(double)*ss.dims != write(fd, params, sizeof(double)*ss.dims)){
+			return false;
+		}
+	}
+	return true;
 }
 
+/*	This function wraps write_info() and write_dim_sets() together for the simple case of writing only the nominal parameter set. 
+*/
+bool write_nominal (int fd, int dims, double* nominal) {
+	if(!write_info(fd, dims, 1)) return false;
+	return ((int)sizeof(double)*dims == write(fd, nominal, sizeof(double)*dims) );
+}
@@ -25,37 +25,258 @@ io.hpp contains function declarations for io.cpp.
 
 #include <fcntl.h>		//(Needed to check on open pipes when closing them.)
 #include <sys/wait.h>	//(Waiting on processes to finish and reading their return status.)
+#include <poll.h>		//(Waiting on the result pipes of persistent workers.)
+#include <signal.h>		//(Ignoring SIGPIPE while persistent workers are running.)
+#include <sys/mman.h>	//(memfd_create for in-memory data files, and mapping the nominal parameter sets and features files.)
+#if defined(__SSE2__)
+#include <emmintrin.h>	//(Searching the features files for commas 16 characters at a time.)
+#endif
+#if defined(__has_include)
+#if __has_include(<charconv>)
+#include <charconv>		//(from_chars for converting the values in the features files.)
+#endif
+#endif
 
 #include "init.hpp"
 
 using namespace std;
+
+/*	Struct for a job, i.e. parameter sets of one nominal set that one simulation runs together: the nominal set (dim JOB_NOMINAL), or the sets of dimension dim that plan_job() chose.
+	With --dims-per-job the sets of span dimensions from dim on are packed into one job, one dimension after another, and with --sets-per-job the sets of a dimension can be split among several jobs that each run sets of them from first on. See next_sim_job() in schedule.cpp.
+*/
+struct sim_job{
+	nominal_run* run;
+	int dim; //The first dimension, or JOB_NOMINAL.
+	int span; //The number of dimensions, from dim on.
+	int first; //The first of the sets that plan_job() chose for dim that this job runs, which is only not 0 for a part of a split dimension.
+	int sets; //The number of parameter sets.
+	int memfd; //With --memory-data, the in-memory features file of the job, or -1.
+	bool stored; //Whether the results of the job have been stored in run already (e.g. binary results), so there is no features file to read.
+};
+
+//Struct for one slot of the simulation pool, i.e. one simulation process that runs one job at a time. See start_pool() in io.cpp.
+struct sim_slot{
+	pid_t pid;
+	int* pipes; //Single simulations only: the pipe through which the parameter sets are sent to the child.
+	int job_fd; //Persistent workers only: the write end of the pipe through which jobs are sent to the worker, or the connection of a remote worker. -1 if there is no worker.
+	int result_fd; //Persistent workers only: the read end of the pipe through which the worker reports every finished job, or the connection of a remote worker.
+	char** args; //The arguments the simulation was started with.
+	nominal_run* run; //The nominal set the running job belongs to.
+	int job; //The (first) dimension being simulated, JOB_NOMINAL if it is the nominal set, or SLOT_IDLE.
+	int span; //The number of dimensions of the running job. See sim_job.
+	int first; //The first set of dimension job that the running job simulates.
+	int sets; //The number of parameter sets of the running job.
+	bool stored; //Whether the results of the running job have been stored already.
+	char* received; //The bytes of the running job's results that have been read from result_fd so far.
+	int received_len; //The number of bytes in received.
+	int received_size; //The allocated size of received.
+	bool named; //Whether the simulation has already sent the names of the output features. Every simulation process sends them only once.
+	double started; //When the running job was started, in seconds (see now_seconds() in deadline.cpp).
+	bool late; //Whether the running job has passed its deadline.
+	int twin; //The slot running the other copy of a late job, or -1. See deadline.cpp.
+	bool copy; //Whether the running job is the speculative copy of a late job, which writes its own features file until it finishes first.
+	int memfd; //With --memory-data, the in-memory features file of the running job (or of the copy), or -1.
+	bool cancelled; //Whether the running job was cancelled but cannot be stopped (a plugin thread), so its results are thrown away when it finishes.
+	long peak_rss; //With --processes auto, the peak resident memory of the simulation that ran the last job, in kB. See resources.cpp.
+};
+
+//The simulation plugin and its threads are defined in plugin.hpp.
+struct sim_plugin;
+
+//Struct for holding the simulation pool of a run, which is shared by all nominal sets.
+struct sim_pool{
+	int count;
+	bool persistent; //Whether the slots are persistent workers rather than one child per job.
+	sim_slot* slot;
+	sim_plugin* plugin; //The simulation plugin whose threads are the slots, or NULL if the slots are simulation processes. See plugin.cpp.
+	bool remote; //Whether the slots are remote workers that connect to listen_fd. See remote.cpp.
+	int listen_fd; //The socket remote workers connect to, or -1.
+	bool stopping; //Whether the pool is being stopped, so that no more workers are waited for.
+	sim_job* retry; //The jobs that have to be started again because their remote worker was lost.
+	int retry_count; //The number of jobs in retry.
+	int num_features; //The number of output features sent with binary results, or -1 if none have been sent yet.
+	char** names; //The names of the output features sent with binary results.
+	double* set_times; //With --deadline, the time per parameter set of every job that finished, in seconds, in increasing order.
+	int num_times;
+	int times_size; //The number of times set_times has room for.
+	double median_time; //The median of set_times.
+	int late_jobs; //The number of jobs that passed their deadline.
+	int copies; //The number of speculative copies that were started.
+	int copies_won; //The number of copies that finished before the job they copied.
+	int killed_jobs; //The number of jobs that were killed at their deadline (--kill-late).
+	double slowest; //The longest time a job took (or ran until it was killed), in seconds.
+	int limit; //The number of jobs that may run at once, which is count unless the size of the pool is automatic. See resources.cpp.
+	bool auto_size; //Whether limit follows the CPUs and memory that are available (--processes auto).
+	long max_rss; //The largest peak resident memory of a simulation so far, in kB.
+	int measured; //The number of jobs whose peak memory was measured.
+	int started; //Persistent workers only: the number of slots whose workers have been started, which are the first ones.
+	int span; //With --dims-per-job auto, the number of dimensions per job that was chosen last.
+	int fit_jobs; //With --dims-per-job auto, the number of jobs whose time was measured, and the sums the cost of a job is fitted from. See resources.cpp.
+	double fit_sets;
+	double fit_time;
+	double fit_sets_sq;
+	double fit_sets_time;
+	sim_pool(int processes, bool persist, bool workers){
+		count = processes;
+		persistent = persist;
+		remote = workers;
+		listen_fd = -1;
+		stopping = false;
+		retry = new sim_job[count + 1];
+		retry_count = 0;
+		num_features = -1;
+		names = NULL;
+		set_times = NULL;
+		num_times = 0;
+		times_size = 0;
+		median_time = 0;
+		late_jobs = 0;
+		copies = 0;
+		copies_won = 0;
+		killed_jobs = 0;
+		slowest = 0;
+		limit = count;
+		auto_size = false;
+		max_rss = 0;
+		measured = 0;
+		started = 0;
+		span = 1;
+		fit_jobs = 0;
+		fit_sets = 0;
+		fit_time = 0;
+		fit_sets_sq = 0;
+		fit_sets_time = 0;
+		plugin = NULL;
+		slot = new sim_slot[count];
+		for(int i = 0; i < count; i++){
+			slot[i].pid = 0;
+			slot[i].pipes = NULL;
+			slot[i].job_fd = -1;
+			slot[i].result_fd = -1;
+			slot[i].args = NULL;
+			slot[i].run = NULL;
+			slot[i].job = SLOT_IDLE;
+			slot[i].span = 0;
+			slot[i].first = 0;
+			slot[i].sets = 0;
+			slot[i].stored = false;
+			slot[i].received = NULL;
+			slot[i].received_len = 0;
+			slot[i].received_size = 0;
+			slot[i].named = false;
+			slot[i].started = 0;
+			slot[i].late = false;
+			slot[i].twin = -1;
+			slot[i].copy = false;
+			slot[i].memfd = -1;
+			slot[i].peak_rss = 0;
+			slot[i].cancelled = false;
+		}
+	}
+	~sim_pool(){
+		for(int i = 0; i < count; i++){
+			if(slot[i].received != NULL) delete[] slot[i].received;
+		}
+		delete[] slot;
+		delete[] retry;
+		if(set_times != NULL) delete[] set_times;
+		if(names != NULL){
+			for(int j = 0; j < num_features; j++){
+				delete[] names[j];
+			}
+			delete[] names;
+		}
+	}
+};
+
+//Declaring these here so they can be used by the nominal_index destructor.
+char* map_file(char* , size_t* , bool* );
+void unmap_file(char* , size_t , bool );
+
+//Struct for the nominal parameter sets file, which is read only once and indexed by line so that any set can be found without rereading the file. See index_nominal() in io.cpp.
+struct nominal_index{
+	char* data; //The contents of the file.
+	size_t size; //The number of bytes in data.
+	bool mapped; //Whether data is mapped from the file (and must be unmapped) rather than read into memory.
+	int num_sets; //The number of parameter sets in the file, i.e. lines that are neither blank nor comments.
+	size_t* start; //start[i] is the offset in data of the first character of parameter set i.
+	size_t* end; //end[i] is the offset in data just past the last character of parameter set i.
+	char* line; //A buffer large enough for the longest parameter set, which the set being read is copied into.
+	nominal_index(){
+		data = NULL;
+		size = 0;
+		mapped = false;
+		num_sets = 0;
+		start = NULL;
+		end = NULL;
+		line = NULL;
+	}
+	~nominal_index(){
+		if(data != NULL) unmap_file(data, size, mapped);
+		if(start != NULL) delete[] start;
+		if(end != NULL) delete[] end;
+		if(line != NULL) delete[] line;
+	}
+};
+
 /* Function declarations */
 //File input:
 void read_nominal(input_params& );
-int count_params(FILE* );
-bool fill_doubles(FILE* , int , double* );
-void skip_lines( FILE* , int);
-double** load_output(int, int*, char*, char*** );
+nominal_index* index_nominal(char* );
+void close_nominal(input_params& );
+int count_params(const char* );
+bool fill_doubles(const char* , int , double* );
+matrix* load_output(int, int*, char*, char***, output_layout* , mem_arena* );
+const char* next_separator(const char* , const char* );
+double parse_double(const char* , const char* );
 
 //File output:
-void write_sensitivity(int , int , char** , double** , char*  );
+void write_sensitivity(int , int , char** , matrix& , char*  );
 
 //Simulation execution functions:
-void simulate_samples(int , input_params& , sim_set&  );
-void simulate_nominal(input_params& );
+bool start_pool(input_params& );
+void stop_pool(input_params& );
+int idle_slot(input_params& );
+bool simulate_job(input_params& , sim_job& );
+bool wait_job(input_params& , sim_job* );
+
+//Single simulation and persistent worker functions:
+bool launch_job(input_params& , sim_slot& );
+int wait_child(input_params& );
+bool start_worker(input_params& , int );
+bool send_job(input_params& , sim_slot& );
+int wait_results(input_params& );
+bool finish_child(input_params& , sim_slot& );
+
+//Simulation result functions:
+int job_sets(nominal_run& , int );
+int plan_job(input_params& , nominal_run& , int );
+sim_job whole_job(nominal_run& , int );
+sim_job slot_job(sim_slot& );
+void share_output(nominal_run& , int );
+char* job_file(input_params& , sim_job& );
+char* slot_file(input_params& , sim_slot& , pid_t );
+bool open_memory_file(input_params& , int , int* );
+void close_memory_file(sim_job& );
+bool collect_job(input_params& , sim_job& );
+bool store_output(input_params& , sim_job& , matrix* , int );
+int results_size(input_params& , sim_slot& );
+bool store_results(input_params& , sim_slot& , int );
+void copy_names(input_params& , nominal_run& , int );
+char** arena_names(mem_arena* , char** , int );
 
 //Simulation execution helper functions:
-char*** make_all_args(int , input_params& ,int** );
-void make_arg(int , int , int, int* , char* , char* , char** , char** );
+char** make_arg(int , int , int* , char* , char** );
 char* make_name(char* , char* , int );
-void del_args(int, int, char*** );
-void del_arg(int , char** );
+void del_arg(char** );
 bool make_pipes(int , int** );
 void del_pipes(int , int** , bool );
 void segs_per_sim(int , int , int* );
 bool write_info(int , int, int);
-bool write_dim_sets(int , int , double* , sim_set& );
-bool write_nominal(input_params& , int );
+bool write_dim_sets(int , int , double* , sim_set& , int* , int );
+bool write_trajectory_sets(int , sim_set& , int , int* , int );
+bool write_job_sets(input_params& , int , sim_job& );
+bool write_nominal(int , int , double* );
 bool check_status(int , int , int* , char** );
 
 #endif
@@ -0,0 +1,524 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+journal.cpp contains the journal that lets a run that was stopped be resumed.
+*/
+
+#include "journal.hpp" // Function declarations
+
+#include "analysis.hpp"
+#include "cache.hpp"
+#include "io.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	Every run that calculates sensitivities keeps a journal ("journal" in the data directory), to which a record is appended whenever the results of a job are in and whenever the results files of a nominal set have been written.
+	A run that was stopped at any point can then be continued with --resume and the same --data-dir: the sets whose results files are still the ones that were written are skipped, and the other sets only simulate the jobs that had not finished.
+	Every record is written with a single write() as:
+		[int JOURNAL_MAGIC][int type][int length][length bytes][uint64_t hash of the type, length and bytes]
+	so a run that is killed leaves at most one incomplete record at the end, which is cut off when the journal is resumed.
+	JOURNAL_RUN, the first record: [uint64_t journal_key()][int random seed]
+	JOURNAL_JOB: [int set][int dim][uint64_t nominal_hash() of the set][int count][int features][count ints: the columns of the sets (see plan_job() in io.cpp)][count x features doubles][only for the nominal set, for every feature: int length and the name]
+	JOURNAL_SET: [int set][uint64_t nominal_hash() of the set][uint64_t hash of the sensitivity file][uint64_t hash of the normalized sensitivity file]
+	The journal holds the results themselves rather than pointing to the features files, so it works with --delete-data, --memory-data and --binary-results as well.
+*/
+
+//Returns the (mallocated) name of the journal in the data directory.
+char* journal_name (input_params& ip) {
+	char* name = (char*)mallocate(sizeof(char)*(strlen(ip.data_dir) + strlen("/journal") + 1));
+	sprintf(name, "%s/journal", ip.data_dir);
+	return name;
+}
+
+/*	Returns the hash of every setting the results in the journal depend on: the simulation, its arguments and the random seed (see simulation_key() in cache.cpp), and the perturbations, which are trajectories with --method morris, and the screen that chooses the parameters that get every point.
+*/
+uint64_t journal_key (input_params& ip) {
+	uint64_t key = simulation_key(ip);
+	key = hash_bytes(key, &ip.percentage, sizeof(double));
+	if(ip.method == METHOD_MORRIS){
+		key = hash_bytes(key, &ip.method, sizeof(int));
+		key = hash_bytes(key, &ip.trajectories, sizeof(int));
+		return hash_bytes(key, &ip.levels, sizeof(int));
+	}
+	key = hash_bytes(key, &ip.points, sizeof(int));
+	//Runs without a screen keep the key of the journals written before there was one.
+	if(ip.screen > 0 || ip.screen_top > 0){
+		key = hash_bytes(key, &ip.screen, sizeof(double));
+		key = hash_bytes(key, &ip.screen_top, sizeof(int));
+	}
+	return hash_bytes(key, &ip.tolerance, sizeof(double));
+}
+
+/*	Returns the random seed of the run the journal in the data directory belongs to, or 0 if there is no journal. A resumed run uses the same seed unless it is given one, since the results depend on it.
+*/
+int journal_seed (input_params& ip) {
+	char* name = journal_name(ip);
+	size_t size = 0;
+	bool mapped = false;
+	char* data = map_file(name, &size, &mapped);
+	mfree(name);
+	if(data == NULL){
+		return 0;
+	}
+	size_t pos = 0;
+	int type = 0;
+	char* body = NULL;
+	int length = 0;
+	int seed = 0;
+	if(next_record(data, size, &pos, &type, &body, &length) && type == JOURNAL_RUN && length == sizeof(uint64_t) + sizeof(int)){
+		memcpy(&seed, body + sizeof(uint64_t), sizeof(int));
+	}
+	unmap_file(data, size, mapped);
+	return seed;
+}
+
+/*	Opens the journal of the run as ip.journal. A new run starts a new journal, while a run with --resume reads in the journal that is there, cuts off anything after its last complete record and appends to it.
+	Exits through usage() if the journal cannot be written, or cannot be resumed because there is none or it belongs to a run with different settings.
+*/
+void open_journal (input_params& ip) {
+	ip.journal = new run_journal();
+	run_journal& journal = *ip.journal;
+	journal.key = journal_key(ip);
+	char* name = journal_name(ip);
+	if(ip.resume){
+		size_t size = 0;
+		bool mapped = false;
+		char* data = map_file(name, &size, &mapped);
+		if(data == NULL){
+			usage("There is no journal to resume in the data directory.", 0);
+		}
+		size_t valid = 0;
+		bool same_run = load_journal(ip, data, size, &valid);
+		unmap_file(data, size, mapped);
+		if(!same_run){
+			usage("The journal in the data directory belongs to a run with a different simulation, --sim-args, --random-seed, --percentage, --points, --tolerance, --screen or --method settings, so it cannot be resumed.", 0);
+		}
+		journal.fd = open(name, O_WRONLY | O_APPEND);
+		if(journal.fd != -1 && ftruncate(journal.fd, (off_t)valid) == -1){
+			close(journal.fd);
+			journal.fd = -1;
+		}
+		cout << "\n ~ Resuming: " << journal.num_done << " sets were finished before, and " << journal.num_jobs << " jobs of the other sets are reused ~ \n";
+	} else{
+		journal.fd = open(name, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+		char body[sizeof(uint64_t) + sizeof(int)];
+		memcpy(body, &journal.key, sizeof(uint64_t));
+		memcpy(body + sizeof(uint64_t), &ip.random_seed, sizeof(int));
+		add_record(ip, JOURNAL_RUN, body, sizeof(body));
+	}
+	if(journal.fd == -1){
+		usage("Could not write the journal in the data directory.", 0);
+	}
+	fcntl(journal.fd, F_SETFD, FD_CLOEXEC);
+	mfree(name);
+}
+
+/*	Closes the journal of the run, if it has one. With --delete-data the journal of a run that finished is deleted with the rest of the data directory, since there is nothing left to resume.
+*/
+void close_journal (input_params& ip) {
+	if(ip.journal == NULL){
+		return;
+	}
+	delete ip.journal;
+	ip.journal = NULL;
+	if(ip.delete_data && ip.failure == NULL){
+		char* name = journal_name(ip);
+		unmake_file(name, true);
+		mfree(name);
+	}
+}
+
+/*	Reads the finished jobs and sets of the journal in data (size bytes) into ip.journal, stopping at the first record that is incomplete or damaged. The jobs of sets whose results files are still there are left out, so a resumed run only holds the results it can use.
+	Stores the number of bytes up to the end of the last record that was read in *valid, which can be more than an int holds.
+	Returns false if the journal belongs to a run with different settings.
+*/
+bool load_journal (input_params& ip, char* data, size_t size, size_t* valid) {
+	run_journal& journal = *ip.journal;
+	size_t pos = 0;
+	int type = 0;
+	char* body = NULL;
+	int length = 0;
+	uint64_t key = 0;
+	*valid = 0;
+	if(!next_record(data, size, &pos, &type, &body, &length) || type != JOURNAL_RUN || length != sizeof(uint64_t) + sizeof(int)){
+		return false;
+	}
+	memcpy(&key, body, sizeof(uint64_t));
+	if(key != journal.key){
+		return false;
+	}
+	size_t start = pos;
+	//The records are counted first so the arrays can be allocated once.
+	int jobs = 0;
+	int sets = 0;
+	while(next_record(data, size, &pos, &type, &body, &length)){
+		jobs += (type == JOURNAL_JOB);
+		sets += (type == JOURNAL_SET);
+	}
+	//A journal can have no jobs (e.g. when every set was finished before), and mallocate refuses to allocate 0 bytes.
+	if(jobs > 0){
+		journal.jobs = new journal_job[jobs];
+	}
+	int* finished = NULL;
+	int num_finished = 0;
+	if(sets > 0){
+		journal.done = new int[sets];
+		journal.done_hashes = new uint64_t[3 * sets];
+		finished = new int[sets];
+	}
+	//The sets whose results files are still there are skipped by set_done(), so the results of their jobs are never read in. A set whose nominal values changed is not skipped, but its jobs do not match its new values either (see resume_job()).
+	pos = start;
+	while(next_record(data, size, &pos, &type, &body, &length)){
+		int set = 0;
+		uint64_t hashes[3];
+		if(type == JOURNAL_SET && take_bytes(&body, body + length, &set, sizeof(int)) && take_bytes(&body, body + length, hashes, 3 * sizeof(uint64_t)) && results_intact(ip, set, hashes)){
+			finished[num_finished++] = set;
+		}
+	}
+	qsort(finished, num_finished, sizeof(int), compare_sets);
+	pos = start;
+	*valid = pos;
+	while(next_record(data, size, &pos, &type, &body, &length)){
+		char* end = body + length;
+		bool read = true;
+		if(type == JOURNAL_JOB){
+			//Only the set of a job of a finished set is looked at. A record too short to hold one is read, and found to be damaged, by read_job().
+			int set = -1;
+			if(length >= (int)sizeof(int)){
+				memcpy(&set, body, sizeof(int));
+			}
+			if(bsearch(&set, finished, num_finished, sizeof(int), compare_sets) == NULL){
+				read = read_job(ip, body, end, journal.jobs[journal.num_jobs]);
+				if(read) journal.num_jobs++;
+			}
+		} else if(type == JOURNAL_SET){
+			int set = 0;
+			uint64_t* hashes = journal.done_hashes + 3 * journal.num_done;
+			read = take_bytes(&body, end, &set, sizeof(int)) && take_bytes(&body, end, hashes, 3 * sizeof(uint64_t));
+			if(read) journal.done[journal.num_done++] = set;
+		}
+		if(!read) break;
+		*valid = pos;
+	}
+	if(finished != NULL) delete[] finished;
+	qsort(journal.jobs, journal.num_jobs, sizeof(journal_job), compare_jobs);
+	return true;
+}
+
+/*	Reads the body of a JOURNAL_JOB record (from body up to end) into job.
+	Returns false (with nothing left allocated) if the body does not hold a whole job.
+*/
+bool read_job (input_params& ip, char* body, char* end, journal_job& job) {
+	job.columns = NULL;
+	job.values = NULL;
+	job.names = NULL;
+	if(!take_bytes(&body, end, &job.set, sizeof(int)) || !take_bytes(&body, end, &job.dim, sizeof(int)) || !take_bytes(&body, end, &job.nominal, sizeof(uint64_t))
+		|| !take_bytes(&body, end, &job.count, sizeof(int)) || !take_bytes(&body, end, &job.features, sizeof(int))){
+		return false;
+	}
+	//A job holds the sets of one dimension, or of one trajectory with --method morris, which has one set more than there are parameters. The number of parameters is only known here when it was given, so until then a trajectory is only bounded by the record, and resume_job() checks it against its nominal set.
+	int max_sets = 2 * ip.points;
+	int max_jobs = ip.dims;
+	if(ip.method == METHOD_MORRIS){
+		max_sets = (ip.dims > 0 ? ip.dims + 1 : (int)((end - body) / sizeof(int)));
+		max_jobs = ip.trajectories;
+	}
+	if(job.count < 0 || job.count > max_sets || job.features < 0 || job.features > MAX_NUM_FEATS || job.dim < JOB_NOMINAL || (max_jobs > 0 && job.dim >= max_jobs)){
+		return false;
+	}
+	job.columns = new int[job.count];
+	job.values = new double[job.count * job.features];
+	bool read = take_bytes(&body, end, job.columns, sizeof(int)*job.count) && take_bytes(&body, end, job.values, sizeof(double)*job.count*job.features);
+	for(int i = 0; i < job.count && read; i++){
+		read = (job.columns[i] >= 0 && job.columns[i] < max_sets);
+	}
+	if(read && job.dim == JOB_NOMINAL){
+		job.names = new char*[job.features];
+		for(int j = 0; j < job.features; j++){
+			int name_length = 0;
+			if(!take_bytes(&body, end, &name_length, sizeof(int)) || name_length < 0 || name_length > end - body){
+				name_length = 0;
+			}
+			job.names[j] = new char[name_length + 1];
+			take_bytes(&body, end, job.names[j], name_length);
+			job.names[j][name_length] = '\0';
+		}
+	}
+	if(!read){
+		delete[] job.columns;
+		delete[] job.values;
+	}
+	return read;
+}
+
+/*	Finds the record that starts at *pos in data (size bytes) and checks that it is complete and undamaged.
+	Returns false if it is not, otherwise stores its type, body and length and moves *pos to the next record.
+*/
+bool next_record (char* data, size_t size, size_t* pos, int* type, char** body, int* length) {
+	size_t head = sizeof(int) * 3;
+	if(*pos + head > size){
+		return false;
+	}
+	int magic = 0;
+	memcpy(&magic, data + *pos, sizeof(int));
+	memcpy(type, data + *pos + sizeof(int), sizeof(int));
+	memcpy(length, data + *pos + sizeof(int)*2, sizeof(int));
+	if(magic != JOURNAL_MAGIC || *length < 0 || *pos + head + *length + sizeof(uint64_t) > size){
+		return false;
+	}
+	uint64_t checksum = 0;
+	memcpy(&checksum, data + *pos + head + *length, sizeof(uint64_t));
+	if(checksum != hash_bytes(CACHE_HASH_START, data + *pos + sizeof(int), sizeof(int)*2 + *length)){
+		return false;
+	}
+	*body = data + *pos + head;
+	*pos += head + *length + sizeof(uint64_t);
+	return true;
+}
+
+//Copies bytes bytes from *cursor into into and moves *cursor past them, unless that would go past end. Returns whether they were copied.
+bool take_bytes (char** cursor, char* end, void* into, size_t bytes) {
+	if(bytes > (size_t)(end - *cursor)){
+		return false;
+	}
+	memcpy(into, *cursor, bytes);
+	*cursor += bytes;
+	return true;
+}
+
+//Copies bytes bytes from from into buffer at *pos and moves *pos past them.
+void put_bytes (char* buffer, size_t* pos, const void* from, size_t bytes) {
+	memcpy(buffer + *pos, from, bytes);
+	*pos += bytes;
+}
+
+/*	Appends a record of the given type with length bytes of body to the journal in a single write.
+*/
+void add_record (input_params& ip, int type, char* body, int length) {
+	size_t size = sizeof(int) * 3 + length + sizeof(uint64_t);
+	char* record = new char[size];
+	size_t pos = 0;
+	int magic = JOURNAL_MAGIC;
+	put_bytes(record, &pos, &magic, sizeof(int));
+	put_bytes(record, &pos, &type, sizeof(int));
+	put_bytes(record, &pos, &length, sizeof(int));
+	put_bytes(record, &pos, body, length);
+	uint64_t checksum = hash_bytes(CACHE_HASH_START, record + sizeof(int), sizeof(int)*2 + length);
+	put_bytes(record, &pos, &checksum, sizeof(uint64_t));
+	//A record that could not be written only means its job is simulated again if the run is resumed.
+	if(write(ip.journal->fd, record, size) != (ssize_t)size){
+		cerr << "Could not write to the journal.\n";
+	}
+	delete[] record;
+}
+
+/*	Adds the results of job dim of run to the journal once they have been collected. Only the sets the job simulated are added, since the others came from the journal or the cache.
+*/
+void journal_job_done (input_params& ip, nominal_run& run, int dim) {
+	int count = run.job_count[dim + 1];
+	int features = run.num_features;
+	if(ip.journal == NULL || count == 0 || features < 0 || (dim == JOB_NOMINAL ? run.nominal_output == NULL : run.dim_output[dim] == NULL)){
+		return;
+	}
+	int nominal_column = 0;
+	int* columns = (dim == JOB_NOMINAL ? &nominal_column : run.job_columns(dim));
+	size_t length = sizeof(int)*4 + sizeof(uint64_t) + sizeof(int)*count + sizeof(double)*count*features;
+	for(int j = 0; dim == JOB_NOMINAL && j < features; j++){
+		length += sizeof(int) + strlen(run.output_names[j]);
+	}
+	char* body = new char[length];
+	size_t pos = 0;
+	uint64_t nominal = nominal_hash(ip, run.nominal);
+	put_bytes(body, &pos, &run.index, sizeof(int));
+	put_bytes(body, &pos, &dim, sizeof(int));
+	put_bytes(body, &pos, &nominal, sizeof(uint64_t));
+	put_bytes(body, &pos, &count, sizeof(int));
+	put_bytes(body, &pos, &features, sizeof(int));
+	put_bytes(body, &pos, columns, sizeof(int)*count);
+	for(int i = 0; i < count; i++){
+		double* values = (dim == JOB_NOMINAL ? run.nominal_output->col(0) : run.dim_output[dim]->col(columns[i]));
+		put_bytes(body, &pos, values, sizeof(double)*features);
+	}
+	for(int j = 0; dim == JOB_NOMINAL && j < features; j++){
+		int name_length = strlen(run.output_names[j]);
+		put_bytes(body, &pos, &name_length, sizeof(int));
+		put_bytes(body, &pos, run.output_names[j], name_length);
+	}
+	add_record(ip, JOURNAL_JOB, body, length);
+	delete[] body;
+}
+
+/*	Adds run to the journal once its results files have been written, together with the hashes of the files, which are synced first so that a set is never skipped for files that did not make it to the disk.
+	A set that has no results for some of its jobs is left out.
+*/
+void journal_set_done (input_params& ip, nominal_run& run) {
+	if(ip.journal == NULL){
+		return;
+	}
+	//A set with jobs that were killed at their deadline is simulated again when the run is resumed.
+	for(int i = 0; i <= run.ss->jobs; i++){
+		if(run.failed[i]) return;
+	}
+	uint64_t hashes[3];
+	hashes[0] = nominal_hash(ip, run.nominal);
+	char* file_name = make_name(ip.sense_dir, ip.sense_file, run.index);
+	hashes[1] = hash_file(file_name, true);
+	mfree(file_name);
+	file_name = make_name(ip.sense_dir, ip.norm_file, run.index);
+	hashes[2] = hash_file(file_name, true);
+	mfree(file_name);
+	char body[sizeof(int) + sizeof(hashes)];
+	memcpy(body, &run.index, sizeof(int));
+	memcpy(body + sizeof(int), hashes, sizeof(hashes));
+	add_record(ip, JOURNAL_SET, body, sizeof(body));
+	fdatasync(ip.journal->fd);
+}
+
+/*	Fills in the results of job dim of run that the journal holds and takes their sets out of the job, in the same way as lookup_job() in cache.cpp.
+	Returns true if no sets of the job are left to simulate.
+*/
+bool resume_job (input_params& ip, nominal_run& run, int dim) {
+	run_journal& journal = *ip.journal;
+	//Finds the first record of the job with a binary search, since the jobs are sorted by set and dimension.
+	journal_job wanted;
+	wanted.set = run.index;
+	wanted.dim = dim;
+	int low = 0;
+	int high = journal.num_jobs;
+	while(low < high){
+		int middle = (low + high) / 2;
+		if(compare_jobs(&journal.jobs[middle], &wanted) < 0){
+			low = middle + 1;
+		} else{
+			high = middle;
+		}
+	}
+	uint64_t nominal = nominal_hash(ip, run.nominal);
+	int* columns = (dim == JOB_NOMINAL ? NULL : run.job_columns(dim));
+	for(int k = low; k < journal.num_jobs && compare_jobs(&journal.jobs[k], &wanted) == 0 && run.job_count[dim + 1] > 0; k++){
+		journal_job& job = journal.jobs[k];
+		if(job.nominal != nominal || (run.num_features != -1 && job.features != run.num_features) || job.count > run.ss->sets_per_dim){
+			continue;
+		}
+		if(dim == JOB_NOMINAL){
+			if(job.count != 1 || job.names == NULL){
+				continue;
+			}
+			run.num_features = job.features;
+			run.output_names = arena_names(run.arena, job.names, job.features);
+			run.nominal_output = arena_matrix(run.arena, job.features, 1, COL_MAJOR);
+			memcpy(run.nominal_output->col(0), job.values, sizeof(double)*job.features);
+			run.job_count[0] = 0;
+			break;
+		}
+		for(int i = 0; i < job.count; i++){
+			//Only the sets the job still has to simulate are taken, e.g. not those of the other rings of an adaptive dimension.
+			int kept = 0;
+			bool found = false;
+			for(int c = 0; c < run.job_count[dim + 1]; c++){
+				if(!found && columns[c] == job.columns[i]){
+					found = true;
+				} else{
+					columns[kept++] = columns[c];
+				}
+			}
+			if(!found){
+				continue;
+			}
+			run.job_count[dim + 1] = kept;
+			run.num_features = job.features;
+			if(run.dim_output[dim] == NULL){
+				run.dim_output[dim] = arena_matrix(run.arena, job.features, run.ss->sets_per_dim, COL_MAJOR);
+			}
+			memcpy(run.dim_output[dim]->col(job.columns[i]), job.values + i * job.features, sizeof(double)*job.features);
+		}
+	}
+	return run.job_count[dim + 1] == 0;
+}
+
+/*	Returns whether the nominal set with the given index (whose values are in ip.nominal) was finished by the run that is resumed and its results files are still the ones that run wrote, in which case the set is skipped.
+*/
+bool set_done (input_params& ip, int index) {
+	run_journal& journal = *ip.journal;
+	for(int i = journal.num_done - 1; i >= 0; i--){
+		if(journal.done[i] != index){
+			continue;
+		}
+		uint64_t* hashes = journal.done_hashes + 3 * i;
+		return hashes[0] == nominal_hash(ip, ip.nominal) && results_intact(ip, index, hashes);
+	}
+	return false;
+}
+
+//Returns whether the two results files of the nominal set with the given index are still the ones whose hashes are hashes[1] and hashes[2] in its JOURNAL_SET record.
+bool results_intact (input_params& ip, int index, uint64_t* hashes) {
+	char* file_name = make_name(ip.sense_dir, ip.sense_file, index);
+	bool same = (hash_file(file_name, false) == hashes[1]);
+	mfree(file_name);
+	file_name = make_name(ip.sense_dir, ip.norm_file, index);
+	same = same && (hash_file(file_name, false) == hashes[2]);
+	mfree(file_name);
+	return same;
+}
+
+//Returns the hash of the values of the nominal set nominal.
+uint64_t nominal_hash (input_params& ip, double* nominal) {
+	return hash_bytes(CACHE_HASH_START, nominal, sizeof(double)*ip.dims);
+}
+
+//Returns the hash of the contents of the file with the given name, or 0 if it could not be read. If sync is true the file is synced to the disk first.
+uint64_t hash_file (char* file_name, bool sync) {
+	if(sync){
+		int fd = open(file_name, O_RDONLY);
+		if(fd != -1){
+			fdatasync(fd);
+			close(fd);
+		}
+	}
+	size_t size = 0;
+	bool mapped = false;
+	char* data = map_file(file_name, &size, &mapped);
+	if(data == NULL){
+		return 0;
+	}
+	uint64_t hash = hash_bytes(CACHE_HASH_START, data, size);
+	unmap_file(data, size, mapped);
+	return hash;
+}
+
+//Orders the indices of nominal sets, for qsort() and bsearch().
+int compare_sets (const void* a, const void* b) {
+	int first = *(const int*)a;
+	int second = *(const int*)b;
+	return (first < second ? -1 : (first > second ? 1 : 0));
+}
+
+//Orders journal jobs by set and then by dimension, for qsort().
+int compare_jobs (const void* a, const void* b) {
+	const journal_job* first = (const journal_job*)a;
+	const journal_job* second = (const journal_job*)b;
+	if(first->set != second->set){
+		return (first->set < second->set ? -1 : 1);
+	}
+	if(first->dim != second->dim){
+		return (first->dim < second->dim ? -1 : 1);
+	}
+	return 0;
+}
@@ -0,0 +1,99 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+journal.hpp contains the journal structs and function declarations for journal.cpp.
+*/
+
+#ifndef JOURNAL_HPP
+#define JOURNAL_HPP
+
+#include <stdint.h>		//(The hashes that check the records.)
+
+#include "init.hpp"
+
+//Struct for the results of one finished job read back from the journal.
+struct journal_job{
+	int set; //The index of the nominal set.
+	int dim; //The dimension, or JOB_NOMINAL.
+	uint64_t nominal; //The hash of the nominal set's values, so results are never resumed into a different set.
+	int count; //The number of sets the job simulated.
+	int features; //The number of output features of every set.
+	int* columns; //The columns of the dimension's perturbed sets (see plan_job() in io.cpp) that the job simulated.
+	double* values; //The features of every set, features doubles apart.
+	char** names; //The names of the features, for the nominal set only.
+};
+
+//Struct for the journal of a run. See journal.cpp.
+struct run_journal{
+	int fd; //The journal file, which is only appended to.
+	uint64_t key; //The hash of the settings the results depend on, which a resumed run has to share.
+	journal_job* jobs; //With --resume, the finished jobs of the journal, sorted by set and dimension.
+	int num_jobs;
+	int* done; //With --resume, the nominal sets whose results were written.
+	uint64_t* done_hashes; //For every set in done, the hash of its nominal values and of its two results files after they were written.
+	int num_done;
+	run_journal(){
+		fd = -1;
+		key = 0;
+		jobs = NULL;
+		num_jobs = 0;
+		done = NULL;
+		done_hashes = NULL;
+		num_done = 0;
+	}
+	~run_journal(){
+		if(fd != -1) close(fd);
+		for(int i = 0; i < num_jobs; i++){
+			delete[] jobs[i].columns;
+			delete[] jobs[i].values;
+			if(jobs[i].names != NULL){
+				for(int j = 0; j < jobs[i].features; j++){
+					delete[] jobs[i].names[j];
+				}
+				delete[] jobs[i].names;
+			}
+		}
+		if(jobs != NULL) delete[] jobs;
+		if(done != NULL) delete[] done;
+		if(done_hashes != NULL) delete[] done_hashes;
+	}
+};
+
+char* journal_name(input_params& );
+uint64_t journal_key(input_params& );
+int journal_seed(input_params& );
+void open_journal(input_params& );
+void close_journal(input_params& );
+bool load_journal(input_params& , char* , size_t , size_t* );
+bool read_job(input_params& , char* , char* , journal_job& );
+bool next_record(char* , size_t , size_t* , int* , char** , int* );
+bool take_bytes(char** , char* , void* , size_t );
+void put_bytes(char* , size_t* , const void* , size_t );
+void add_record(input_params& , int , char* , int );
+void journal_job_done(input_params& , nominal_run& , int );
+void journal_set_done(input_params& , nominal_run& );
+bool resume_job(input_params& , nominal_run& , int );
+bool set_done(input_params& , int );
+bool results_intact(input_params& , int , uint64_t* );
+uint64_t nominal_hash(input_params& , double* );
+uint64_t hash_file(char* , bool );
+int compare_sets(const void* , const void* );
+int compare_jobs(const void* , const void* );
+
+#endif
@@ -24,9 +24,79 @@ This file does not contain any of the macros used by finite-difference.cpp/hpp b
 #ifndef MACROS_HPP
 #define MACROS_HPP
 
+//These macros are the layouts of a matrix (see matrix.hpp) and the cache line size its rows or columns are aligned to.
+#define ROW_MAJOR 0
+#define COL_MAJOR 1
+#define CACHE_LINE 64
+
+//These macros are used by the simulation results cache (see cache.cpp): the FNV-1a hash that names and checks its entries, the first bytes of every entry, and a string that changes whenever the layout of the entries does.
+#define CACHE_HASH_START 14695981039346656037ULL
+#define CACHE_HASH_PRIME 1099511628211ULL
+#define CACHE_MAGIC 0x3145484341434153ULL
+#define CACHE_VERSION "sensitivity-cache-1"
+
+//These macros are used by the coordinator and its remote workers (see remote.cpp): the first int the coordinator sends on every connection, how often a worker tries to connect before giving up, and the seconds between the tries.
+#define REMOTE_MAGIC 0x53454e53
+#define RECONNECT_ATTEMPTS 30
+#define RECONNECT_DELAY 1
+
+//These macros are used by the deadlines of simulation jobs (see deadline.cpp): the number of jobs that have to finish before a deadline that is a multiple of the median time applies, and the shortest such deadline of a job in seconds.
+#define DEADLINE_MIN_JOBS 5
+#define DEADLINE_MIN_TIME 1
+
+//These macros are used by --processes auto (see resources.cpp): the number of simulations run at once until their memory has been measured, the number of jobs that are measured first, and the share of the available memory the simulations may use.
+#define AUTO_START_PROCESSES 2
+#define AUTO_PROBE_JOBS 3
+#define AUTO_MEMORY_SHARE 0.9
+
+//These macros are used by --dims-per-job auto (see resources.cpp): the number of jobs that are measured before dimensions are packed, and the share of the time of a job that starting the simulation may take.
+#define CHUNK_PROBE_JOBS 4
+#define CHUNK_STARTUP_SHARE 0.1
+
+//These macros are used by --analysis-threads (see threads.cpp): the number of chunks the items of the analysis are split into per thread, and the number of finite differences (dimensions x features x points) below which a nominal set is analyzed by the main thread alone.
+#define ANALYSIS_CHUNKS 4
+#define ANALYSIS_MIN_VALUES 20000
+
+//These macros are the methods of --method: local sensitivity analysis of every nominal set, or Morris elementary effects screening in a box around it (see morris.cpp).
+#define METHOD_LSA 0
+#define METHOD_MORRIS 1
+
+//These macros are the phases of a run whose time is reported by --stats (see stats.cpp), and the number of phases.
+#define STAT_SPAWN 0
+#define STAT_SEND 1
+#define STAT_WAIT 2
+#define STAT_PARSE 3
+#define STAT_DIFFERENTIATE 4
+#define STAT_NORMALIZE 5
+#define STAT_WRITE 6
+#define STAT_PHASES 7
+
+//These macros are used by the journal of finished jobs and sets (see journal.cpp): the first bytes of every record, and the types of records.
+#define JOURNAL_MAGIC 0x4c4e524a
+#define JOURNAL_RUN 1
+#define JOURNAL_JOB 2
+#define JOURNAL_SET 3
+
 //This macro specifies the maximum number of features that may be read from a simulation output file. If there are more features than this quantitiy in the output file they will be ignored and their sensitivity will not be calculated. 
 #define MAX_NUM_FEATS 150
 
+//This macro is the exit status with which a simulation child reports failure. See check_status() in io.cpp.
+#define SIM_FAILURE_STATUS 6
+
+/*	Macros for the jobs that are run by the simulation pool. See io.cpp.
+	A slot's job is either a dimension, JOB_NOMINAL or SLOT_IDLE, and every job sent to a persistent worker starts with one of the SIM_JOB codes.
+*/
+#define JOB_NOMINAL -1
+#define SLOT_IDLE -2
+#define SIM_JOB_SHUTDOWN 0
+#define SIM_JOB_NEXT 1
+
+//This macro is the number of bytes by which the buffer for binary results grows whenever it is nearly full.
+#define RESULT_CHUNK 65536
+
+//This macro is the number of nominal sets that may be in flight at once. See schedule.cpp.
+#define MAX_SETS_IN_FLIGHT 3
+
 //	This macro is used when checking infinite values. See the check_num function in analysis.cpp.
 #define INF_SUBSTITUTE 500
 
@@ -0,0 +1,124 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+matrix.hpp contains the matrix struct, which holds a two-dimensional array of doubles in one cache-aligned block, and the vec_view struct for walking one of its rows or columns.
+*/
+
+#ifndef MATRIX_HPP
+#define MATRIX_HPP
+
+#include <cstring>		//(Used for memset.)
+#include <new>			//(Used for placing matrices in an arena.)
+#include <stdint.h>		//(Used for aligning pointers.)
+
+#include "memory.hpp" 	//(Memory tracking functions.)
+#include "macros.hpp"	//(macros)
+
+using namespace std;
+
+//Struct for one row or column of a matrix. It does not own its values, so it is only valid as long as the matrix is.
+struct vec_view{
+	double* data; //The first value.
+	int length; //The number of values.
+	int step; //The distance between consecutive values, which is 1 if they are next to each other.
+	vec_view(double* first, int len, int s){
+		data = first;
+		length = len;
+		step = s;
+	}
+	double& operator[](int i){
+		return data[(size_t)i * step];
+	}
+};
+
+/*	Struct for a rows x cols matrix of doubles, which are stored in one block instead of one block per row.
+	With ROW_MAJOR layout the values of each row are next to each other, with COL_MAJOR layout the values of each column are. Either way at() gives any value, and row_view() and col_view() walk a row or column with the right step, so the layout only decides which of the two walks is contiguous.
+	Rows (or columns) that are at least a cache line long are padded to a whole number of cache lines and start on one, so that walking one never touches the cache lines of its neighbours.
+	A matrix can not be copied, since it owns its block. A matrix made with an arena does not own its block, which is freed with the arena instead (see arena_matrix()).
+*/
+struct matrix{
+	int rows;
+	int cols;
+	int layout; //ROW_MAJOR or COL_MAJOR.
+	int stride; //The distance between the first values of consecutive rows (ROW_MAJOR) or columns (COL_MAJOR).
+	double* data; //The first value, which lies on a cache line boundary.
+	void* block; //The allocated block data lies in.
+	mem_arena* arena; //The arena block was allocated from, or NULL if the matrix owns block.
+	matrix(int r, int c, int lay){
+		init(r, c, lay, NULL);
+	}
+	matrix(int r, int c, int lay, mem_arena* from){
+		init(r, c, lay, from);
+	}
+	~matrix(){
+		if(arena == NULL) mfree(block);
+	}
+	
+	double& at(int r, int c){
+		return (layout == ROW_MAJOR ? data[(size_t)r * stride + c] : data[(size_t)c * stride + r]);
+	}
+	
+	//The values of row r, which are next to each other only with ROW_MAJOR layout.
+	vec_view row_view(int r){
+		return (layout == ROW_MAJOR ? vec_view(data + (size_t)r * stride, cols, 1) : vec_view(data + r, cols, stride));
+	}
+	
+	//The values of column c, which are next to each other only with COL_MAJOR layout.
+	vec_view col_view(int c){
+		return (layout == ROW_MAJOR ? vec_view(data + c, rows, stride) : vec_view(data + (size_t)c * stride, rows, 1));
+	}
+	
+	//A pointer to row r, for functions that take a plain array. Only valid with ROW_MAJOR layout.
+	double* row(int r){
+		return data + (size_t)r * stride;
+	}
+	
+	//A pointer to column c, for functions that take a plain array. Only valid with COL_MAJOR layout.
+	double* col(int c){
+		return data + (size_t)c * stride;
+	}
+	
+private:
+	void init(int r, int c, int lay, mem_arena* from){
+		rows = r;
+		cols = c;
+		layout = lay;
+		arena = from;
+		int line = (layout == ROW_MAJOR ? cols : rows);
+		int lines = (layout == ROW_MAJOR ? rows : cols);
+		int per_cache_line = CACHE_LINE / sizeof(double);
+		stride = (line >= per_cache_line ? ((line + per_cache_line - 1) / per_cache_line) * per_cache_line : line);
+		size_t bytes = (size_t)stride * lines * sizeof(double);
+		//The extra cache line leaves room to move data up to the next boundary (and keeps mallocate from being asked for 0 bytes).
+		block = (arena == NULL ? mallocate(bytes + CACHE_LINE) : arena_alloc(arena, bytes + CACHE_LINE));
+		data = (double*)(((uintptr_t)block + CACHE_LINE - 1) & ~(uintptr_t)(CACHE_LINE - 1));
+		memset(data, 0, bytes);
+	}
+	matrix(const matrix& );
+	matrix& operator=(const matrix& );
+};
+
+/*	Makes a rows x cols matrix whose values and struct both come from arena, so that it goes away when the arena is reset.
+	It must not be deleted.
+*/
+inline matrix* arena_matrix(mem_arena* arena, int rows, int cols, int layout){
+	return new (arena_alloc(arena, sizeof(matrix))) matrix(rows, cols, layout, arena);
+}
+
+#endif
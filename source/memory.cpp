@@ -19,6 +19,8 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 /*
 memory.cpp contains functions related to memory management. All memory related functions should be placed in this file.
 Many features and functions are enabled only when scons-compiling with 'memtrack=1', which defines the MEMTRACK macro used for memory tracking.
+The memory tracker counts every allocation with atomic counters, so it stays correct when several threads allocate at once (e.g. the threads of a simulation plugin). It keeps the current, peak and total heap usage and the number of allocations and frees, both for the whole program and for every MEM_TAG (see memory.hpp), and a histogram of the allocation sizes in powers of two.
+Memory that lives exactly as long as one piece of work (e.g. one nominal set, see nominal_run in init.hpp) can come from an arena instead, which allocates large blocks that are freed all at once, or reused for the next piece of work.
 */
 
 #ifndef INIT_HPP
@@ -31,8 +33,60 @@ using namespace std;
 
 // Variables the memory tracker uses to keep track of heap usage
 #if defined(MEMTRACK)
-	size_t heap_current = 0;
-	size_t heap_total = 0;
+	#include <atomic>			// (Counting allocations from several threads.)
+	#include <sstream>			// (Writing a report in one piece.)
+	#include <pthread.h>		// (The thread that writes the periodic reports.)
+	#include <time.h>			// (Sleeping between periodic reports.)
+	#include <sys/resource.h>	// (The peak resident memory of the program.)
+	
+	//The number of buckets of the size histogram: bucket b counts the allocations of 2^b up to 2^(b+1)-1 bytes, and the last bucket every larger one.
+	#define MEM_BUCKETS 40
+	
+	//The header in front of every tracked block. Its 16 bytes keep the block aligned like malloc's.
+	struct mem_header{
+		size_t size;
+		int tag;
+		int unused;
+	};
+	
+	//Struct for the counters of heap usage, of the program or of one tag. Static counters start out as 0.
+	struct mem_counters{
+		atomic<size_t> current;
+		atomic<size_t> peak;
+		atomic<size_t> total;
+		atomic<size_t> allocations;
+		atomic<size_t> frees;
+	};
+	
+	static mem_counters heap;
+	static mem_counters tag_heap[MEM_TAGS];
+	static atomic<size_t> size_buckets[MEM_BUCKETS];
+	static __thread int current_tag = MEM_OTHER;
+	static const char* tag_names[MEM_TAGS] = {"other", "sim_set", "load_output", "results", "lsa", "args"};
+	
+	//Adds an allocation of size bytes to counters and raises their peak if needed.
+	static void count_allocation (mem_counters& counters, size_t size) {
+		size_t now = counters.current.fetch_add(size, memory_order_relaxed) + size;
+		counters.total.fetch_add(size, memory_order_relaxed);
+		counters.allocations.fetch_add(1, memory_order_relaxed);
+		size_t peak = counters.peak.load(memory_order_relaxed);
+		while (now > peak && !counters.peak.compare_exchange_weak(peak, now, memory_order_relaxed));
+	}
+	
+	//Removes a freed block of size bytes from counters.
+	static void count_free (mem_counters& counters, size_t size) {
+		counters.current.fetch_sub(size, memory_order_relaxed);
+		counters.frees.fetch_add(1, memory_order_relaxed);
+	}
+	
+	mem_scope::mem_scope (int tag) {
+		previous = current_tag;
+		current_tag = tag;
+	}
+	
+	mem_scope::~mem_scope () {
+		current_tag = previous;
+	}
 #endif
 
 /* mallocate allocates a block of memory with the given size
@@ -41,7 +95,7 @@ using namespace std;
 	returns: a pointer to the block of memory allocated
 	notes:
 		This function is a thin wrapper for malloc that exits if the memory cannot be allocated or a nonpositive size is given.
-		If memory tracking is enabled, extra bytes are allocated with every request to store the size of the request. The memory tracker does not count these extra bytes when reporting heap usage.
+		If memory tracking is enabled, extra bytes are allocated with every request to store the size of the request and its tag. The memory tracker does not count these extra bytes when reporting heap usage.
 		Memory allocated with mallocate should be freed with mfree, not free.
 	todo:
 */
@@ -49,7 +103,7 @@ void* mallocate (size_t size) {
 	if (size > 0) {
 		void* block;
 		#if defined(MEMTRACK)
-			block = malloc(sizeof(size_t) + size);
+			block = malloc(sizeof(mem_header) + size);
 		#else
 			block = malloc(size);
 		#endif
@@ -58,11 +112,14 @@ void* mallocate (size_t size) {
 			exit(EXIT_MEMORY_ERROR);
 		}
 		#if defined(MEMTRACK)
-			heap_current += size;
-			heap_total += size;
-			size_t* sizeblock = (size_t*)block;
-			*sizeblock = size;
-			return (void*)(sizeblock + 1);
+			mem_header* header = (mem_header*)block;
+			header->size = size;
+			header->tag = current_tag;
+			count_allocation(heap, size);
+			count_allocation(tag_heap[header->tag], size);
+			int bucket = 63 - __builtin_clzll((unsigned long long)size);
+			size_buckets[bucket < MEM_BUCKETS ? bucket : MEM_BUCKETS - 1].fetch_add(1, memory_order_relaxed);
+			return (void*)(header + 1);
 		#else
 			return block;
 		#endif
@@ -84,9 +141,10 @@ void* mallocate (size_t size) {
 void mfree (void* mem) {
 	#if defined(MEMTRACK)
 		if (mem != NULL) {
-			size_t* memblock = (size_t*)mem - 1;
-			heap_current -= *memblock;
-			free(memblock);
+			mem_header* header = (mem_header*)mem - 1;
+			count_free(heap, header->size);
+			count_free(tag_heap[header->tag], header->size);
+			free(header);
 		}
 	#else
 		free(mem);
@@ -141,48 +199,242 @@ void operator delete[] (void* mem) {
 	mfree(mem);
 }
 
+mem_arena::mem_arena () {
+	first = NULL;
+	last = NULL;
+	current = NULL;
+	used = 0;
+	next = NULL;
+}
+
+mem_arena::~mem_arena () {
+	while (first != NULL) {
+		arena_block* block = first;
+		first = first->next;
+		mfree(block);
+	}
+}
+
+/* arena_alloc allocates a block of memory from an arena
+	parameters:
+		arena: the arena to allocate from
+		size: the number of bytes to allocate
+	returns: a pointer to the memory, aligned to ARENA_ALIGN
+	notes:
+		The memory is handed out from the current block of the arena. When it does not fit, the arena moves on to its next block that it fits in (which after a reset is one it already has), and only allocates a new block, of at least ARENA_BLOCK_SIZE bytes, if there is none.
+		The memory is not set to 0, and it can not be freed with mfree: it is freed when the arena is.
+	todo:
+*/
+void* arena_alloc (mem_arena* arena, size_t size) {
+	size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+	if (arena->current != NULL && arena->used + size > arena->current->size) {
+		do {
+			arena->current = arena->current->next;
+		} while (arena->current != NULL && size > arena->current->size);
+		arena->used = 0;
+	}
+	if (arena->current == NULL) {
+		size_t block_size = (size > ARENA_BLOCK_SIZE ? size : ARENA_BLOCK_SIZE);
+		arena_block* block = (arena_block*)mallocate(sizeof(arena_block) + block_size);
+		block->next = NULL;
+		block->size = block_size;
+		if (arena->last == NULL) {
+			arena->first = block;
+		} else {
+			arena->last->next = block;
+		}
+		arena->last = block;
+		arena->current = block;
+		arena->used = 0;
+	}
+	void* memory = (char*)(arena->current + 1) + arena->used;
+	arena->used += size;
+	return memory;
+}
+
+/* reset_arena frees everything that was allocated from an arena at once
+	parameters:
+		arena: the arena to reset
+	returns: nothing
+	notes:
+		The arena keeps its blocks, and hands their memory out again from the first one.
+	todo:
+*/
+void reset_arena (mem_arena* arena) {
+	arena->current = arena->first;
+	arena->used = 0;
+}
+
+/* take_arena takes an arena from a list of spare arenas
+	parameters:
+		spares: the first arena of the list, which is updated
+	returns: the first spare arena, or a new arena if the list is empty
+	notes:
+	todo:
+*/
+mem_arena* take_arena (mem_arena** spares) {
+	mem_arena* arena = *spares;
+	if (arena == NULL) {
+		return new mem_arena();
+	}
+	*spares = arena->next;
+	arena->next = NULL;
+	return arena;
+}
+
+/* give_arena resets an arena and puts it back in a list of spare arenas
+	parameters:
+		spares: the first arena of the list, which is updated
+		arena: the arena, which must not be used anymore
+	returns: nothing
+	notes:
+		The arena keeps its blocks, so the next take_arena() gets an arena that does not have to allocate.
+	todo:
+*/
+void give_arena (mem_arena** spares, mem_arena* arena) {
+	reset_arena(arena);
+	arena->next = *spares;
+	*spares = arena;
+}
+
+/* free_arenas frees a list of spare arenas and all of their blocks
+	parameters:
+		spares: the first arena of the list
+	returns: nothing
+	notes:
+	todo:
+*/
+void free_arenas (mem_arena* spares) {
+	while (spares != NULL) {
+		mem_arena* arena = spares;
+		spares = spares->next;
+		delete arena;
+	}
+}
+
 #if defined(MEMTRACK)
 
-/* print_mem_amount prints the given number of bytes in a human-friendly format
+/* write_mem_amount writes the given number of bytes in a human-friendly format
 	parameters:
-		mem: the number of bytes to print
+		out: the stream to write to
+		mem: the number of bytes to write
 	returns: nothing
 	notes:
 	todo:
 */
-static void print_mem_amount (size_t mem) {
+static void write_mem_amount (ostream& out, size_t mem) {
 	static size_t kB = 1024;
 	static size_t MB =(1024)*(1024);
 	static size_t GB = (1024)*(1024)*(1024);
 	double dmem = mem;
 	
 	if (mem > GB) {
-		cout << dmem / GB << " GB";
+		out << dmem / GB << " GB";
 	} else if (mem > MB) {
-		cout << dmem / MB << " MB";
+		out << dmem / MB << " MB";
 	} else if (mem > kB) {
-		cout << dmem / kB << " kB";
+		out << dmem / kB << " kB";
 	} else {
-		cout << dmem << " B";
+		out << dmem << " B";
+	}
+}
+
+/* write_heap_usage writes the heap usage calculated with the memory tracker
+	parameters:
+		out: the stream to write to
+	returns: nothing
+	notes:
+		Current heap usage indicates how much unfreed memory is on the heap, peak heap usage the most there ever was at once, and total heap usage how much memory has been allocated since the program's inception.
+		The same is written for every tag that has allocated anything, followed by the sizes of the allocations and the peak resident memory of the program, which includes what is not allocated through mallocate.
+		The counters are read while other threads may still be allocating, so the numbers of a report taken during a run need not add up exactly.
+	todo:
+*/
+static void write_heap_usage (ostream& out) {
+	out << "Current heap usage:\t";
+	write_mem_amount(out, heap.current.load());
+	out << "\nPeak heap usage:\t";
+	write_mem_amount(out, heap.peak.load());
+	out << "\nTotal heap usage:\t";
+	write_mem_amount(out, heap.total.load());
+	out << "\nAllocations:\t\t" << heap.allocations.load() << " (" << heap.frees.load() << " freed)\n";
+	out << "Heap usage by tag (current / peak / total, allocations):\n";
+	for (int t = 0; t < MEM_TAGS; t++) {
+		mem_counters& counters = tag_heap[t];
+		if (counters.allocations.load() == 0) continue;
+		out << "\t" << tag_names[t] << ":\t";
+		write_mem_amount(out, counters.current.load());
+		out << " / ";
+		write_mem_amount(out, counters.peak.load());
+		out << " / ";
+		write_mem_amount(out, counters.total.load());
+		out << ", " << counters.allocations.load() << "\n";
+	}
+	out << "Allocations by size:\n";
+	for (int b = 0; b < MEM_BUCKETS; b++) {
+		size_t count = size_buckets[b].load();
+		if (count == 0) continue;
+		out << "\t";
+		write_mem_amount(out, (size_t)1 << b);
+		out << (b == MEM_BUCKETS - 1 ? " and up" : "") << ":\t" << count << "\n";
+	}
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) == 0) {
+		out << "Peak resident memory:\t";
+		write_mem_amount(out, (size_t)usage.ru_maxrss * 1024);
+		out << "\n";
 	}
-	cout << endl;
 }
 
-/* print_heap_usage prints the current and total heap usage calculated with the memory tracker
+/* print_heap_usage prints the heap usage calculated with the memory tracker (see write_heap_usage)
 	parameters:
 	returns: nothing
 	notes:
-		Current heap usage indicates how much unfreed memory is on the heap.
-		Total heap usage indicates how much memory has been allocated since the program's inception.
 		Do not call this function after free_terminal or reset_cout since it uses terminal colors allocated by init_terminal and quiet mode does not work after reset_cout.
 	todo:
 */
 void print_heap_usage () {
-	cout <<  "Current heap usage:\t";
-	print_mem_amount(heap_current);
-	cout << "Total heap usage:\t";
-	print_mem_amount(heap_total);
+	write_heap_usage(cout);
 }
 
-#endif
+/* heap_dumps is the thread started by start_heap_dumps
+	parameters:
+		interval: a pointer to the number of seconds between reports
+	returns: nothing
+	notes:
+		Every report is written to cerr in one piece, so that it is not mixed up with the output of the run.
+	todo:
+*/
+static void* heap_dumps (void* interval) {
+	double seconds = *(double*)interval;
+	while (true) {
+		struct timespec wait_for = {(time_t)seconds, (long)((seconds - (time_t)seconds) * 1e9)};
+		while (nanosleep(&wait_for, &wait_for) == -1);
+		ostringstream report;
+		report << "\n~ Heap usage ~\n";
+		write_heap_usage(report);
+		cerr << report.str() << flush;
+	}
+	return NULL;
+}
 
+/* start_heap_dumps starts a thread that writes the heap usage every few seconds for as long as the program runs
+	parameters:
+		seconds: the time between reports, or 0 for no reports
+	returns: nothing
+	notes:
+		This is useful for watching the heap usage of a long run, which print_heap_usage only reports at exit.
+	todo:
+*/
+void start_heap_dumps (double seconds) {
+	static double interval = 0;
+	if (seconds <= 0 || interval > 0) {
+		return;
+	}
+	interval = seconds;
+	pthread_t thread;
+	if (pthread_create(&thread, NULL, heap_dumps, &interval) == 0) {
+		pthread_detach(thread);
+	}
+}
+
+#endif
@@ -29,8 +29,59 @@ using namespace std;
 
 void* mallocate(size_t);
 void mfree(void*);
+
+//The size of the blocks an arena allocates, unless one allocation needs a larger block.
+#define ARENA_BLOCK_SIZE (64*1024)
+//Every allocation from an arena starts on a multiple of this many bytes, like malloc's.
+#define ARENA_ALIGN 16
+
+//The header in front of the memory of every block of an arena. Its 16 bytes keep the memory aligned to ARENA_ALIGN.
+struct arena_block{
+	arena_block* next; //The next block of the arena, or NULL.
+	size_t size; //The number of bytes after the header.
+};
+
+/*	Struct for an arena, which hands out memory from a few large blocks by moving a pointer forward, and frees all of it at once (see arena_alloc() in memory.cpp).
+	Resetting an arena keeps its blocks, so work that is done again and again in the same arena (e.g. one nominal set after another) only allocates the first time.
+	Nothing allocated from an arena can be freed or deleted on its own, and destructors of objects in it are not called.
+*/
+struct mem_arena{
+	arena_block* first; //The blocks, in the order they were allocated.
+	arena_block* last; //The last block, to which new blocks are added.
+	arena_block* current; //The block memory is handed out from, or NULL if the arena has no blocks yet.
+	size_t used; //The number of bytes of the current block that have been handed out.
+	mem_arena* next; //The next arena in a list of spare arenas, see take_arena().
+	mem_arena();
+	~mem_arena();
+};
+
+void* arena_alloc(mem_arena*, size_t);
+void reset_arena(mem_arena*);
+mem_arena* take_arena(mem_arena** );
+void give_arena(mem_arena** , mem_arena*);
+void free_arenas(mem_arena*);
+
+//Tags for the parts of the program whose heap usage the memory tracker reports separately. Every allocation is counted under the tag of the innermost MEM_TAG() in scope on its thread, or MEM_OTHER.
+#define MEM_OTHER 0
+#define MEM_SIM_SET 1
+#define MEM_LOAD_OUTPUT 2
+#define MEM_RESULTS 3
+#define MEM_LSA 4
+#define MEM_ARGS 5
+#define MEM_TAGS 6
+
 #if defined(MEMTRACK)
+	//Struct that counts the allocations of its thread under tag for as long as it is in scope. Use it through MEM_TAG().
+	struct mem_scope{
+		int previous;
+		mem_scope(int);
+		~mem_scope();
+	};
+	#define MEM_TAG(tag) mem_scope mem_scope_here(tag)
 	void print_heap_usage();
+	void start_heap_dumps(double);
+#else
+	#define MEM_TAG(tag)
 #endif
 
 #endif
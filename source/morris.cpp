@@ -0,0 +1,177 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+morris.cpp contains the Morris elementary effects screening of --method morris.
+*/
+
+#include "morris.hpp" // Function declarations
+
+#include "analysis.hpp"
+#include "io.hpp"
+#include "stats.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	With --method morris a nominal set is screened instead of being analyzed locally: its parameters are ranked from ip.trajectories one-at-a-time trajectories (Morris, 1991) in the box of --percentage around the nominal set, which takes trajectories x (dims + 1) simulations instead of dims x 2 x points.
+	Every parameter moves on a grid of ip.levels levels from its nominal value - percentage (level 0) to + percentage (the last level). A trajectory starts at a random point of the grid and changes one parameter after another, in a random order, by delta = levels / (2 (levels - 1)) of the box, so each of its steps is an elementary effect of one parameter.
+	Every trajectory is a job of the nominal set (see sim_set in init.hpp), which runs like the job of a dimension: it is cached, journaled, packed with --dims-per-job, split with --sets-per-job and copied or killed at its deadline. A trajectory that was killed is left out of the statistics.
+	The elementary effects are made non-dimensional like the local sensitivities (see non_dim_sense() in macros.hpp), i.e. with the nominal value of the parameter and the nominal output, so the three results files have the layout of the files of the local analysis:
+		mu_star_N: the mean of the absolute elementary effects of every parameter on every feature, which ranks the parameters.
+		mu_N: the mean of the elementary effects, whose sign tells the direction of the effect unless the effects of the parameter have different signs.
+		sigma_N: the standard deviation of the elementary effects, which is large for parameters that interact with others or have a nonlinear effect.
+	normalized_N holds mu_star as a percentage of the total of every feature, like normalize() does with the local sensitivities.
+*/
+
+/*	Fills the trajectories of run (see sim_set in init.hpp) with parameter sets. The grid points and the order of the steps are drawn from the random seed and the index of the set, so the same set gets the same trajectories when it is simulated again, e.g. by a resumed run.
+*/
+void make_trajectories (input_params& ip, nominal_run& run) {
+	sim_set& ss = *run.ss;
+	double delta = ip.levels / (2.0 * (ip.levels - 1));
+	double spread = ip.percentage / 100;
+	unsigned int state = (unsigned int)ip.random_seed * 2654435761u + (unsigned int)run.index;
+	double* unit = run.alloc<double>(ss.dims);
+	double* step = run.alloc<double>(ss.dims);
+	for(int t = 0; t < ss.jobs; t++){
+		int* order = ss.order + t * ss.dims;
+		for(int i = 0; i < ss.dims; i++){
+			order[i] = i;
+		}
+		for(int i = ss.dims - 1; i > 0; i--){
+			int j = rand_r(&state) % (i + 1);
+			int swap = order[i];
+			order[i] = order[j];
+			order[j] = swap;
+		}
+		//Every parameter starts at a level from which it can move up by delta, and moves up or down at random.
+		for(int i = 0; i < ss.dims; i++){
+			unit[i] = (double)(rand_r(&state) % (ip.levels / 2)) / (ip.levels - 1);
+			step[i] = delta;
+			if(rand_r(&state) % 2 == 1){
+				unit[i] += delta;
+				step[i] = -delta;
+			}
+		}
+		double* first = ss.trajectories->row(t * ss.sets_per_dim);
+		for(int i = 0; i < ss.dims; i++){
+			first[i] = at_least_zero( run.nominal[i] * ((double)1 + spread * (2 * unit[i] - 1)) );
+		}
+		for(int k = 0; k < ss.dims; k++){
+			double* point = ss.trajectories->row(t * ss.sets_per_dim + k + 1);
+			//Rows are padded to whole cache lines (see matrix.hpp), so the previous point is found by its row, not by the number of dimensions.
+			memcpy(point, ss.trajectories->row(t * ss.sets_per_dim + k), sizeof(double) * ss.dims);
+			int i = order[k];
+			unit[i] += step[i];
+			point[i] = at_least_zero( run.nominal[i] * ((double)1 + spread * (2 * unit[i] - 1)) );
+		}
+	}
+}
+
+/*	Calculates the statistics of the elementary effects of a nominal set whose simulations have all finished and writes them out. See the description at the top of this file.
+*/
+void morris_all_dims (input_params& ip, nominal_run& run) {
+	MEM_TAG(MEM_LSA);
+	int num_dependent = run.num_features;
+	matrix& mu = *arena_matrix(run.arena, ip.dims, num_dependent, ROW_MAJOR);
+	matrix& mu_star = *arena_matrix(run.arena, ip.dims, num_dependent, ROW_MAJOR);
+	matrix& sigma = *arena_matrix(run.arena, ip.dims, num_dependent, ROW_MAJOR);
+	double started = stat_clock(ip);
+	elementary_effects(run, mu, mu_star, sigma);
+	stat_add(ip, &run, STAT_DIFFERENTIATE, started);
+	started = stat_clock(ip);
+	char* file_name = make_name(ip.sense_dir, ip.sense_file, run.index);
+	write_sensitivity(ip.dims, num_dependent, run.output_names, mu_star, file_name);
+	mfree(file_name);
+	file_name = make_name(ip.sense_dir, (char*)"mu_", run.index);
+	write_sensitivity(ip.dims, num_dependent, run.output_names, mu, file_name);
+	mfree(file_name);
+	file_name = make_name(ip.sense_dir, (char*)"sigma_", run.index);
+	write_sensitivity(ip.dims, num_dependent, run.output_names, sigma, file_name);
+	mfree(file_name);
+	stat_add(ip, &run, STAT_WRITE, started);
+	
+	//mu has been written, so it keeps which parameters have no elementary effects while mu_star is normalized in place.
+	started = stat_clock(ip);
+	normalize(mu_star);
+	for(int i = 0; i < ip.dims; i++){
+		for(int j = 0; j < num_dependent; j++){
+			if(isnan(mu.at(i, j))){
+				mu_star.row(i)[j] = NAN;
+			}
+		}
+	}
+	stat_add(ip, &run, STAT_NORMALIZE, started);
+	started = stat_clock(ip);
+	file_name = make_name(ip.sense_dir, ip.norm_file, run.index);
+	write_sensitivity(ip.dims, num_dependent, run.output_names, mu_star, file_name);
+	mfree(file_name);
+	stat_add(ip, &run, STAT_WRITE, started);
+}
+
+/*	Fills the rows of mu, mu_star and sigma (dims x num_features) with the mean, the mean of the absolute values and the standard deviation of the elementary effects of every parameter on every feature, from the trajectories of run that were simulated.
+	A step whose parameter did not change (e.g. because its nominal value is 0) has no elementary effect. A parameter without any gets 0 if its nominal value is 0, like a parameter that is not perturbed by the local analysis, and nan otherwise (when every trajectory was killed at its deadline).
+*/
+void elementary_effects (nominal_run& run, matrix& mu, matrix& mu_star, matrix& sigma) {
+	sim_set& ss = *run.ss;
+	int num_dependent = run.num_features;
+	matrix& nominal_output = *run.nominal_output;
+	int* count = run.alloc<int>(ss.dims);
+	for(int i = 0; i < ss.dims; i++){
+		count[i] = 0;
+		memset(mu.row(i), 0, sizeof(double) * num_dependent);
+		memset(mu_star.row(i), 0, sizeof(double) * num_dependent);
+		memset(sigma.row(i), 0, sizeof(double) * num_dependent);
+	}
+	//Until the statistics are taken, mu, mu_star and sigma hold the sums of the effects, of their absolute values and of their squares.
+	for(int t = 0; t < ss.jobs; t++){
+		if(run.failed[t + 1] || run.dim_output[t] == NULL) continue;
+		matrix& y = *run.dim_output[t];
+		for(int k = 0; k < ss.dims; k++){
+			int i = ss.order[t * ss.dims + k];
+			double dx = ss.trajectories->at(t * ss.sets_per_dim + k + 1, i) - ss.trajectories->at(t * ss.sets_per_dim + k, i);
+			if(dx == 0) continue;
+			double* before = y.col(k);
+			double* after = y.col(k + 1);
+			for(int j = 0; j < num_dependent; j++){
+				double effect = non_dim_sense(run.nominal[i], nominal_output.at(j, 0), (check_num(after[j]) - check_num(before[j])) / dx);
+				mu.row(i)[j] += effect;
+				mu_star.row(i)[j] += fabs(effect);
+				sigma.row(i)[j] += effect * effect;
+			}
+			count[i]++;
+		}
+	}
+	for(int i = 0; i < ss.dims; i++){
+		int n = count[i];
+		for(int j = 0; j < num_dependent; j++){
+			if(n == 0){
+				double none = (run.nominal[i] == 0 ? 0 : NAN);
+				mu.row(i)[j] = none;
+				mu_star.row(i)[j] = none;
+				sigma.row(i)[j] = none;
+				continue;
+			}
+			double mean = mu.row(i)[j] / n;
+			double squares = sigma.row(i)[j];
+			mu.row(i)[j] = mean;
+			mu_star.row(i)[j] /= n;
+			sigma.row(i)[j] = (n > 1 ? sqrt(fmax((squares - n * mean * mean) / (n - 1), 0)) : 0);
+		}
+	}
+}
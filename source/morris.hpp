@@ -0,0 +1,32 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+morris.hpp contains function declarations for morris.cpp.
+*/
+
+#ifndef MORRIS_HPP
+#define MORRIS_HPP
+
+#include "init.hpp"
+
+void make_trajectories(input_params& , nominal_run& );
+void morris_all_dims(input_params& , nominal_run& );
+void elementary_effects(nominal_run& , matrix& , matrix& , matrix& );
+
+#endif
@@ -0,0 +1,262 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+plugin.cpp contains the simulation backend for plugins: shared libraries that export the C functions declared in simulation-plugin.h and are called from threads of this program instead of being run as simulation processes.
+*/
+
+#include "plugin.hpp" // Function declarations
+
+#include "cache.hpp"
+#include "deadline.hpp"
+#include "io.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	A plugin is used when --exec names a file ending in ".so". It takes the place of the simulation processes of ip.pool: every slot of the pool is a thread that calls sensitivity_simulate() for the jobs it is given, and the results are stored straight into the nominal_run like --binary-results, so there are no processes, pipes or features files.
+	The scheduler still runs in the main thread only. A job is handed to a thread by send_plugin_job() and is picked up again by wait_plugin(), which is what wait_job() in io.cpp waits on in this mode.
+*/
+
+//Returns whether path names a simulation plugin rather than a simulation program.
+bool is_plugin (const char* path) {
+	size_t length = strlen(path);
+	return length > 3 && strcmp(path + length - 3, ".so") == 0;
+}
+
+/*	Loads the plugin ip.sim_exec, calls its sensitivity_init() with the --sim-args and starts a thread for every slot of ip.pool.
+	Returns false (with ip.failure set) if the plugin could not be loaded or initialized, or a thread could not be started.
+*/
+bool open_plugin (input_params& ip) {
+	sim_plugin* plugin = new sim_plugin(ip.pool->count);
+	ip.pool->plugin = plugin;
+	//dlopen() searches the library path for names without a slash, but --exec is always a path.
+	char* path = (char*)mallocate(sizeof(char)*(strlen(ip.sim_exec) + 3));
+	sprintf(path, "%s%s", (strchr(ip.sim_exec, '/') == NULL ? "./" : ""), ip.sim_exec);
+	plugin->library = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+	mfree(path);
+	if(plugin->library == NULL){
+		const char* fail_prefix = "!!! Failure: could not load the simulation plugin: ";
+		const char* reason = dlerror();
+		ip.failure = (char*)mallocate(sizeof(char)*(strlen(fail_prefix) + strlen(reason) + 5 + 1));
+		sprintf(ip.failure, "%s%s !!!\n", fail_prefix, reason);
+		return false;
+	}
+	plugin->simulate = (sensitivity_simulate_fn)dlsym(plugin->library, "sensitivity_simulate");
+	plugin->finish = (sensitivity_finish_fn)dlsym(plugin->library, "sensitivity_finish");
+	sensitivity_init_fn init = (sensitivity_init_fn)dlsym(plugin->library, "sensitivity_init");
+	if(plugin->simulate == NULL){
+		ip.failure = copy_str("!!! Failure: the simulation plugin does not export sensitivity_simulate() !!!");
+		return false;
+	}
+	if(init != NULL){
+		//The plugin gets the arguments given with --sim-args, after its own path like a program would.
+		int argc = 1;
+		char** argv = new char*[ip.sim_args_num + 1];
+		argv[0] = ip.sim_exec;
+		for(int i = 9 + ip.protocol_args; i < ip.sim_args_num && ip.simulation_args[i] != NULL; i++){
+			argv[argc++] = ip.simulation_args[i];
+		}
+		argv[argc] = NULL;
+		int code = init(argc, argv, ip.random_seed);
+		delete[] argv;
+		if(code != 0){
+			ip.failure = copy_str("!!! Failure: the simulation plugin could not be initialized !!!");
+			ip.failcode = code;
+			return false;
+		}
+	}
+	for(int i = 0; i < plugin->count; i++){
+		if(pthread_create(&plugin->task[i].thread, NULL, plugin_thread, &plugin->task[i]) != 0){
+			ip.failure = copy_str("!!! Failure: could not start a simulation thread !!!");
+			return false;
+		}
+		plugin->started++;
+	}
+	return true;
+}
+
+/*	Stops the threads of the plugin in ip.pool, which must not have any jobs left, calls its sensitivity_finish() and unloads it.
+*/
+void close_plugin (input_params& ip) {
+	sim_plugin* plugin = ip.pool->plugin;
+	if(plugin == NULL){
+		return;
+	}
+	pthread_mutex_lock(&plugin->lock);
+	plugin->stopping = true;
+	pthread_cond_broadcast(&plugin->wake);
+	pthread_mutex_unlock(&plugin->lock);
+	for(int i = 0; i < plugin->started; i++){
+		pthread_join(plugin->task[i].thread, NULL);
+	}
+	if(plugin->library != NULL){
+		if(plugin->finish != NULL){
+			plugin->finish();
+		}
+		dlclose(plugin->library);
+	}
+	delete plugin;
+	ip.pool->plugin = NULL;
+}
+
+/*	The function every plugin thread runs: it waits for its task to be ready, simulates it and reports it as finished, until the plugin is stopped.
+	It only calls the plugin, so that nothing but the plugin itself runs outside of the main thread.
+*/
+void* plugin_thread (void* arg) {
+	plugin_task& task = *(plugin_task*)arg;
+	sim_plugin& plugin = *task.plugin;
+	pthread_mutex_lock(&plugin.lock);
+	while(true){
+		while(!task.ready && !plugin.stopping){
+			pthread_cond_wait(&plugin.wake, &plugin.lock);
+		}
+		if(!task.ready){
+			break;
+		}
+		pthread_mutex_unlock(&plugin.lock);
+		//A name the plugin leaves unset is an empty name, not the one of the job before.
+		memset(task.names, 0, sizeof(const char*)*MAX_NUM_FEATS);
+		int result = plugin.simulate(task.dims, task.sets, task.params, MAX_NUM_FEATS, task.features, task.names);
+		pthread_mutex_lock(&plugin.lock);
+		task.result = result;
+		task.ready = false;
+		plugin.finished[plugin.finished_count++] = task.index;
+		pthread_cond_signal(&plugin.done);
+	}
+	pthread_mutex_unlock(&plugin.lock);
+	return NULL;
+}
+
+/*	Hands the job of slot i to its plugin thread: the parameter sets that plan_job() chose are laid out one after another in the thread's task, one dimension of the job after another.
+	Returns true, since handing over a job cannot fail.
+*/
+bool send_plugin_job (input_params& ip, int i) {
+	plugin_task& task = ip.pool->plugin->task[i];
+	sim_slot& slot = ip.pool->slot[i];
+	nominal_run& run = *slot.run;
+	int dim = slot.job;
+	int sets = slot.sets;
+	int dims = run.ss->dims;
+	if(sets > task.capacity || dims != task.dims){
+		if(task.params != NULL) delete[] task.params;
+		if(task.features != NULL) delete[] task.features;
+		task.capacity = (sets > run.ss->sets_per_dim ? sets : run.ss->sets_per_dim);
+		task.params = new double[task.capacity * dims];
+		task.features = new double[task.capacity * MAX_NUM_FEATS];
+	}
+	task.dims = dims;
+	task.sets = sets;
+	if(dim == JOB_NOMINAL){
+		memcpy(task.params, run.nominal, sizeof(double)*dims);
+	} else{
+		double* params = task.params;
+		for(int d = dim; d < dim + slot.span; d++){
+			int count = (slot.span == 1 ? sets : job_sets(run, d));
+			int* columns = run.job_columns(d) + slot.first;
+			for(int k = 0; k < count; k++, params += dims){
+				job_set(run, d, columns[k], params);
+			}
+		}
+	}
+	sim_plugin& plugin = *ip.pool->plugin;
+	pthread_mutex_lock(&plugin.lock);
+	task.ready = true;
+	pthread_cond_broadcast(&plugin.wake);
+	pthread_mutex_unlock(&plugin.lock);
+	return true;
+}
+
+/*	Waits until the job of any plugin thread has finished and stores its results in the job's nominal_run, like store_results() in io.cpp does with binary results.
+	Returns the index of the slot whose job finished, or -1 if no job is running or the next running job became late first (see deadline_timeout() in deadline.cpp). If the job failed, ip.failure is set.
+*/
+int wait_plugin (input_params& ip) {
+	MEM_TAG(MEM_RESULTS);
+	sim_plugin& plugin = *ip.pool->plugin;
+	int busy = 0;
+	for(int i = 0; i < ip.pool->count; i++){
+		if(ip.pool->slot[i].job != SLOT_IDLE) busy++;
+	}
+	if(busy == 0){
+		return -1;
+	}
+	int timeout = deadline_timeout(ip);
+	struct timespec until;
+	clock_gettime(CLOCK_REALTIME, &until);
+	until.tv_sec += timeout / 1000;
+	until.tv_nsec += (timeout % 1000) * 1000000L;
+	if(until.tv_nsec >= 1000000000L){
+		until.tv_sec++;
+		until.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock(&plugin.lock);
+	while(plugin.finished_count == 0){
+		if(timeout == -1){
+			pthread_cond_wait(&plugin.done, &plugin.lock);
+		} else if(pthread_cond_timedwait(&plugin.done, &plugin.lock, &until) == ETIMEDOUT && plugin.finished_count == 0){
+			pthread_mutex_unlock(&plugin.lock);
+			return -1;
+		}
+	}
+	int i = plugin.finished[0];
+	plugin.finished_count--;
+	memmove(plugin.finished, plugin.finished + 1, sizeof(int)*plugin.finished_count);
+	pthread_mutex_unlock(&plugin.lock);
+	
+	plugin_task& task = plugin.task[i];
+	sim_slot& slot = ip.pool->slot[i];
+	//The job was stopped at its deadline or lost to its copy, so its results are not wanted. See deadline.cpp.
+	if(slot.cancelled){
+		return i;
+	}
+	if(task.result < 0){
+		ip.failure = copy_str("!!! Failure: simulation plugin could not simulate its job !!!");
+		ip.failcode = task.result;
+		return i;
+	}
+	int features = min(task.result, MAX_NUM_FEATS);
+	if(ip.pool->names == NULL){
+		ip.pool->names = new char*[features];
+		ip.pool->num_features = features;
+		for(int j = 0; j < features; j++){
+			const char* name = (task.names[j] != NULL ? task.names[j] : "");
+			ip.pool->names[j] = new char[strlen(name) + 1];
+			strcpy(ip.pool->names[j], name);
+		}
+	}
+	if(ip.pool->num_features != features){
+		ip.failure = copy_str("!!! Failure: simulations of one nominal set returned different numbers of features !!!");
+		ip.failcode = features;
+		return i;
+	}
+	matrix* output = arena_matrix(slot.run->arena, features, task.sets, COL_MAJOR);
+	for(int s = 0; s < task.sets; s++){
+		double* values = output->col(s);
+		memcpy(values, task.features + s*MAX_NUM_FEATS, sizeof(double)*features);
+		for(int j = 0; j < features; j++){
+			values[j] = check_num(values[j]);
+		}
+	}
+	if(slot.job == JOB_NOMINAL){
+		copy_names(ip, *slot.run, features);
+	}
+	sim_job job = slot_job(slot);
+	store_output(ip, job, output, features);
+	slot.stored = job.stored;
+	return i;
+}
@@ -0,0 +1,110 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+plugin.hpp contains the simulation plugin structs and function declarations for plugin.cpp.
+*/
+
+#ifndef PLUGIN_HPP
+#define PLUGIN_HPP
+
+#include <dlfcn.h>		//(Loading the simulation plugin.)
+#include <pthread.h>	//(The threads that call the simulation plugin.)
+
+#include "init.hpp"
+#include "simulation-plugin.h"
+
+struct sim_plugin;
+
+//Struct for the job of one plugin thread. Everything but ready and result is only touched by the thread while ready is true, and by the main thread otherwise.
+struct plugin_task{
+	sim_plugin* plugin; //The plugin the thread belongs to.
+	int index; //The index of the thread, which is also its slot of the simulation pool.
+	pthread_t thread;
+	bool ready; //Whether the job in params is waiting to be simulated or is being simulated.
+	int dims; //The number of parameters of every set.
+	int sets; //The number of parameter sets in params.
+	int capacity; //The number of parameter sets params and features have room for.
+	double* params; //The parameter sets, one after another.
+	double* features; //The output features of every set, MAX_NUM_FEATS doubles apart.
+	const char** names; //The names of the output features, which point into the plugin.
+	int result; //What sensitivity_simulate() returned.
+};
+
+//Struct for a loaded simulation plugin and its threads, one for every slot of the simulation pool.
+struct sim_plugin{
+	void* library;
+	sensitivity_simulate_fn simulate;
+	sensitivity_finish_fn finish;
+	int count; //The number of threads.
+	int started; //The number of threads that have been started.
+	plugin_task* task;
+	pthread_mutex_t lock; //Guards ready, result, finished, finished_count and stopping.
+	pthread_cond_t wake; //Signalled when a thread has a job or has to stop.
+	pthread_cond_t done; //Signalled when a thread has finished its job.
+	int* finished; //The threads whose jobs have finished but have not been waited on, in the order they finished.
+	int finished_count;
+	bool stopping;
+	sim_plugin(int threads){
+		library = NULL;
+		simulate = NULL;
+		finish = NULL;
+		count = threads;
+		started = 0;
+		task = new plugin_task[count];
+		for(int i = 0; i < count; i++){
+			task[i].plugin = this;
+			task[i].index = i;
+			task[i].ready = false;
+			task[i].dims = 0;
+			task[i].sets = 0;
+			task[i].capacity = 0;
+			task[i].params = NULL;
+			task[i].features = NULL;
+			task[i].names = new const char*[MAX_NUM_FEATS]();
+			task[i].result = 0;
+		}
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&wake, NULL);
+		pthread_cond_init(&done, NULL);
+		finished = new int[count];
+		finished_count = 0;
+		stopping = false;
+	}
+	~sim_plugin(){
+		for(int i = 0; i < count; i++){
+			if(task[i].params != NULL) delete[] task[i].params;
+			if(task[i].features != NULL) delete[] task[i].features;
+			delete[] task[i].names;
+		}
+		delete[] task;
+		delete[] finished;
+		pthread_mutex_destroy(&lock);
+		pthread_cond_destroy(&wake);
+		pthread_cond_destroy(&done);
+	}
+};
+
+bool is_plugin(const char* );
+bool open_plugin(input_params& );
+void close_plugin(input_params& );
+void* plugin_thread(void* );
+bool send_plugin_job(input_params& , int );
+int wait_plugin(input_params& );
+
+#endif
@@ -0,0 +1,379 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+remote.cpp contains the coordinator and the worker of runs that are spread over several machines.
+*/
+
+#include "remote.hpp" // Function declarations
+
+#include "io.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	With --listen the run is a coordinator: it holds the jobs of every nominal set like any other run, but its simulation pool is made of remote workers that connect to it over TCP instead of simulation processes.
+	A worker is this program started with --worker on any machine, with the --exec and --sim-args of the simulation on that machine. It runs one job at a time with its local simulation and sends the results back.
+	A connected worker takes the place of a persistent worker (see io.cpp) whose job pipe and result pipe are both its connection, so the jobs and results are framed exactly like those of persistent workers with --binary-results:
+		coordinator to worker, once per connection: [int REMOTE_MAGIC][int random seed]
+		coordinator to worker, per job: [int SIM_JOB_NEXT][int length of the file name][the file name, which the worker ignores][int dims][int sets][sets x dims doubles], or [int SIM_JOB_SHUTDOWN]
+		worker to coordinator, per job: [int status, 0 if the job succeeded][int F][the names of the F features, only in the first results of a connection][F doubles for every set]
+	The ints and doubles are sent in the byte order of the machines, so every machine of a run has to use the same one.
+	A worker whose connection is lost (because it or its machine died) is dropped and its job is requeued for the next idle worker. A worker that loses its connection tries to connect again, so a restarted coordinator or a network outage only interrupts it.
+*/
+
+/*	Starts listening for workers on the port given with --listen. Returns false (with ip.failure set) if the port could not be used.
+*/
+bool open_listener (input_params& ip) {
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd == -1){
+		ip.failure = copy_str("!!! Failure: could not make a socket !!!");
+		return false;
+	}
+	int reuse = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	struct sockaddr_in address;
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_addr.s_addr = htonl(INADDR_ANY);
+	address.sin_port = htons(ip.listen_port);
+	if(bind(fd, (struct sockaddr*)&address, sizeof(address)) == -1 || listen(fd, ip.pool->count) == -1){
+		close(fd);
+		ip.failure = copy_str("!!! Failure: could not listen for workers on the given port !!!");
+		ip.failcode = ip.listen_port;
+		return false;
+	}
+	//A worker that is gone leaves its connection without a reader. Ignoring SIGPIPE turns writing to it into a failed write instead of killing this program.
+	signal(SIGPIPE, SIG_IGN);
+	ip.pool->listen_fd = fd;
+	cout << "Waiting for up to " << ip.pool->count << " workers on port " << ip.listen_port << "\n";
+	return true;
+}
+
+/*	Tells every connected worker to shut down and stops listening.
+*/
+void close_listener (input_params& ip) {
+	int code = SIM_JOB_SHUTDOWN;
+	for(int i = 0; i < ip.pool->count; i++){
+		sim_slot& slot = ip.pool->slot[i];
+		if(slot.job_fd == -1) continue;
+		write_exact(slot.job_fd, &code, sizeof(int));
+		close(slot.job_fd);
+		slot.job_fd = -1;
+		slot.result_fd = -1;
+	}
+	if(ip.pool->listen_fd != -1){
+		close(ip.pool->listen_fd);
+		ip.pool->listen_fd = -1;
+	}
+}
+
+/*	Accepts a worker that is connecting and gives it a free slot of ip.pool. A worker that finds every slot taken is disconnected, and keeps trying to connect.
+	Returns true iff a worker was added.
+*/
+bool accept_worker (input_params& ip) {
+	int fd = accept(ip.pool->listen_fd, NULL, NULL);
+	if(fd == -1){
+		return false;
+	}
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	int i = 0;
+	while(i < ip.pool->count && (ip.pool->slot[i].job_fd != -1 || ip.pool->slot[i].job != SLOT_IDLE)){
+		i++;
+	}
+	int hello[2] = {REMOTE_MAGIC, ip.random_seed};
+	if(i == ip.pool->count || !write_exact(fd, hello, sizeof(hello))){
+		close(fd);
+		return false;
+	}
+	keep_alive(fd);
+	sim_slot& slot = ip.pool->slot[i];
+	slot.job_fd = fd;
+	slot.result_fd = fd;
+	slot.received_len = 0;
+	//Every connection is a new simulation process as far as the names of the features are concerned.
+	slot.named = false;
+	cout << "Worker " << i << " connected\n";
+	return true;
+}
+
+/*	Disconnects the worker of slot i. Its job, if it has one, is requeued for another worker.
+*/
+void drop_worker (input_params& ip, int i) {
+	sim_slot& slot = ip.pool->slot[i];
+	if(slot.job_fd != -1){
+		close(slot.job_fd);
+	}
+	slot.job_fd = -1;
+	slot.result_fd = -1;
+	if(slot.job != SLOT_IDLE){
+		//A job that has a copy on another worker (see deadline.cpp) is left to the copy.
+		if(slot.twin == -1){
+			requeue_job(ip, slot_job(slot));
+		} else{
+			ip.pool->slot[slot.twin].twin = -1;
+			slot.twin = -1;
+		}
+		slot.run = NULL;
+		slot.job = SLOT_IDLE;
+	}
+	slot.late = false;
+	slot.copy = false;
+	cout << "Worker " << i << " disconnected\n";
+}
+
+/*	Queues job to be started again, because the worker it was given to is gone. The job's sets are still the ones plan_job() chose for it.
+*/
+void requeue_job (input_params& ip, sim_job job) {
+	job.memfd = -1;
+	job.stored = false;
+	ip.pool->retry[ip.pool->retry_count] = job;
+	ip.pool->retry_count++;
+}
+
+/*	Takes the oldest requeued job and stores it in *job. Returns false if there is none.
+*/
+bool next_retry (input_params& ip, sim_job* job) {
+	if(ip.pool == NULL || ip.pool->retry_count == 0){
+		return false;
+	}
+	*job = ip.pool->retry[0];
+	ip.pool->retry_count--;
+	memmove(ip.pool->retry, ip.pool->retry + 1, sizeof(sim_job)*ip.pool->retry_count);
+	return true;
+}
+
+/*	Runs this program as a worker of the coordinator at ip.worker_address ("host:port") until it is told to shut down.
+	Every lost connection is followed by up to RECONNECT_ATTEMPTS tries to connect again, RECONNECT_DELAY seconds apart. If they all fail, ip.failure is set.
+*/
+void run_worker (input_params& ip) {
+	signal(SIGPIPE, SIG_IGN);
+	bool shutdown = false;
+	int attempts = 0;
+	while(!shutdown && attempts < RECONNECT_ATTEMPTS){
+		int fd = connect_coordinator(ip.worker_address);
+		int hello[2] = {0, 0};
+		if(fd != -1 && read_exact(fd, hello, sizeof(hello)) && hello[0] == REMOTE_MAGIC){
+			attempts = 0;
+			//The simulations have to use the coordinator's seed for their results to be the same on every worker.
+			ip.random_seed = hello[1];
+			cout << "Connected to the coordinator at " << ip.worker_address << "\n";
+			serve_coordinator(ip, fd, &shutdown);
+		} else{
+			attempts++;
+		}
+		if(fd != -1){
+			close(fd);
+		}
+		if(!shutdown){
+			sleep(RECONNECT_DELAY);
+		}
+	}
+	if(!shutdown){
+		ip.failure = copy_str("!!! Failure: could not connect to the coordinator !!!");
+	}
+}
+
+/*	Connects to the coordinator at address ("host:port"). Returns the connection, or -1 if it could not be made.
+*/
+int connect_coordinator (const char* address) {
+	const char* colon = strrchr(address, ':');
+	if(colon == NULL){
+		return -1;
+	}
+	char* host = copy_str(address);
+	host[colon - address] = '\0';
+	struct addrinfo hints;
+	memset(&hints, 0, sizeof(hints));
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
+	struct addrinfo* found = NULL;
+	int fd = -1;
+	if(getaddrinfo(host, colon + 1, &hints, &found) == 0){
+		for(struct addrinfo* next = found; next != NULL && fd == -1; next = next->ai_next){
+			fd = socket(next->ai_family, next->ai_socktype, next->ai_protocol);
+			if(fd != -1 && connect(fd, next->ai_addr, next->ai_addrlen) == -1){
+				close(fd);
+				fd = -1;
+			}
+		}
+		freeaddrinfo(found);
+	}
+	mfree(host);
+	if(fd != -1){
+		fcntl(fd, F_SETFD, FD_CLOEXEC);
+		keep_alive(fd);
+	}
+	return fd;
+}
+
+/*	Simulates the jobs the coordinator sends on fd until it sends SIM_JOB_SHUTDOWN, which sets *shutdown.
+	Returns false if the connection was lost.
+*/
+bool serve_coordinator (input_params& ip, int fd, bool* shutdown) {
+	bool named = false;
+	char* file_name = make_name(ip.data_dir, (char*)"task_", getpid());
+	bool connected = true;
+	while(connected){
+		int header[2] = {0, 0};
+		if(!read_exact(fd, header, sizeof(int))){
+			connected = false;
+			break;
+		}
+		if(header[0] == SIM_JOB_SHUTDOWN){
+			*shutdown = true;
+			break;
+		}
+		//The file name is the coordinator's, the features file of the job is written on this machine.
+		int info[2] = {0, 0};
+		connected = read_exact(fd, header + 1, sizeof(int)) && header[1] >= 0;
+		char* ignored = (connected ? new char[header[1] + 1] : NULL);
+		connected = connected && read_exact(fd, ignored, header[1]) && read_exact(fd, info, sizeof(info)) && info[0] > 0 && info[1] > 0;
+		if(ignored != NULL) delete[] ignored;
+		if(!connected) break;
+		double* params = new double[info[0] * info[1]];
+		connected = read_exact(fd, params, sizeof(double)*info[0]*info[1]);
+		if(!connected){
+			delete[] params;
+			break;
+		}
+		
+		matrix* output = NULL;
+		char** names = NULL;
+		int status = simulate_task(ip, file_name, info[0], info[1], params, &output, (named ? NULL : &names));
+		delete[] params;
+		//The results are sent in one write: the status, then with a successful job the features, their names the first time, and the values of every set.
+		int features = (status == 0 ? output->rows : 0);
+		size_t length = sizeof(int)*2 + sizeof(double)*features*info[1];
+		for(int j = 0; names != NULL && j < features; j++){
+			length += sizeof(int) + strlen(names[j]);
+		}
+		char* reply = new char[length];
+		size_t pos = 0;
+		memcpy(reply + pos, &status, sizeof(int));
+		pos += sizeof(int);
+		if(status == 0){
+			memcpy(reply + pos, &features, sizeof(int));
+			pos += sizeof(int);
+			for(int j = 0; names != NULL && j < features; j++){
+				int name_length = strlen(names[j]);
+				memcpy(reply + pos, &name_length, sizeof(int));
+				pos += sizeof(int);
+				memcpy(reply + pos, names[j], name_length);
+				pos += name_length;
+			}
+			for(int s = 0; s < info[1]; s++){
+				memcpy(reply + pos, output->col(s), sizeof(double)*features);
+				pos += sizeof(double)*features;
+			}
+			named = true;
+		}
+		connected = write_exact(fd, reply, pos);
+		delete[] reply;
+		if(output != NULL) delete output;
+		if(names != NULL){
+			for(int j = 0; j < features; j++){
+				delete[] names[j];
+			}
+			delete[] names;
+		}
+	}
+	mfree(file_name);
+	return connected;
+}
+
+/*	Simulates the sets parameter sets of dims parameters in params with the local simulation, exactly like a single simulation of a job is run (see launch_job() in io.cpp), and reads its features file file_name.
+	The results are stored in *output (a features x sets matrix) and, if names is not NULL, the names of the features in *names.
+	Returns 0 if the simulation succeeded, or the status to send the coordinator otherwise.
+*/
+int simulate_task (input_params& ip, char* file_name, int dims, int sets, double* params, matrix** output, char*** names) {
+	int pipes[2];
+	if(pipe(pipes) == -1){
+		return 1;
+	}
+	char** child_args = make_arg(ip.sim_args_num, ip.random_seed, pipes, file_name, ip.simulation_args);
+	pid_t simpid = fork();
+	if(simpid == 0){
+		execv(ip.sim_exec, child_args);
+		cerr << "!!! Failure: could not exec " << ip.sim_exec << " !!!\n";
+		_exit(SIM_FAILURE_STATUS);
+	}
+	int info[2] = {dims, sets};
+	bool good = (simpid != -1 && write_exact(pipes[1], info, sizeof(info)) && write_exact(pipes[1], params, sizeof(double)*dims*sets));
+	int status = 0;
+	if(simpid != -1){
+		waitpid(simpid, &status, WUNTRACED);
+	}
+	close(pipes[0]);
+	close(pipes[1]);
+	del_arg(child_args);
+	//A failed simulation only fails this job, which the coordinator reports.
+	char* failure = NULL;
+	int failcode = 0;
+	good = good && check_status(status, simpid, &failcode, &failure);
+	if(failure != NULL){
+		mfree(failure);
+	}
+	if(!good){
+		return (failcode != 0 ? failcode : 1);
+	}
+	int features = 0;
+	*output = load_output(sets, &features, file_name, names, &ip.layout, NULL);
+	unmake_file(file_name, true);
+	return (*output == NULL ? 1 : 0);
+}
+
+/*	Turns on TCP keepalive for fd, so that a connection to a machine that went down is noticed after about half a minute instead of hours.
+*/
+void keep_alive (int fd) {
+	int on = 1;
+	setsockopt(fd, SOL_SOCKET, SO_KEEPALIVE, &on, sizeof(on));
+	#ifdef TCP_KEEPIDLE
+		int idle = 10, interval = 5, count = 3;
+		setsockopt(fd, IPPROTO_TCP, TCP_KEEPIDLE, &idle, sizeof(idle));
+		setsockopt(fd, IPPROTO_TCP, TCP_KEEPINTVL, &interval, sizeof(interval));
+		setsockopt(fd, IPPROTO_TCP, TCP_KEEPCNT, &count, sizeof(count));
+	#endif
+}
+
+//Reads exactly length bytes from fd into destination. Returns false if the connection ended first.
+bool read_exact (int fd, void* destination, size_t length) {
+	char* into = (char*)destination;
+	while(length > 0){
+		ssize_t got = read(fd, into, length);
+		if(got == -1 && errno == EINTR) continue;
+		if(got <= 0) return false;
+		into += got;
+		length -= got;
+	}
+	return true;
+}
+
+//Writes all length bytes of source to fd. Returns false if the connection ended first.
+bool write_exact (int fd, const void* source, size_t length) {
+	const char* from = (const char*)source;
+	while(length > 0){
+		ssize_t put = write(fd, from, length);
+		if(put == -1 && errno == EINTR) continue;
+		if(put <= 0) return false;
+		from += put;
+		length -= put;
+	}
+	return true;
+}
@@ -0,0 +1,53 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+remote.hpp contains function declarations for remote.cpp.
+*/
+
+#ifndef REMOTE_HPP
+#define REMOTE_HPP
+
+#include <sys/socket.h>		//(The connections between the coordinator and its workers.)
+#include <netinet/in.h>		//(The address the coordinator listens on.)
+#include <netinet/tcp.h>	//(TCP keepalive settings, so that workers on machines that went down are noticed.)
+#include <netdb.h>			//(Looking up the address of the coordinator.)
+
+#include "init.hpp"
+#include "io.hpp"
+
+//Coordinator functions:
+bool open_listener(input_params& );
+void close_listener(input_params& );
+bool accept_worker(input_params& );
+void drop_worker(input_params& , int );
+void requeue_job(input_params& , sim_job );
+bool next_retry(input_params& , sim_job* );
+
+//Worker functions:
+void run_worker(input_params& );
+int connect_coordinator(const char* );
+bool serve_coordinator(input_params& , int , bool* );
+int simulate_task(input_params& , char* , int , int , double* , matrix** , char*** );
+
+//Connection helper functions:
+void keep_alive(int );
+bool read_exact(int , void* , size_t );
+bool write_exact(int , const void* , size_t );
+
+#endif
@@ -0,0 +1,286 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+resources.cpp contains the sizing of the simulation pool from the CPUs and memory the run may use.
+*/
+
+#include "resources.hpp" // Function declarations
+
+#include "deadline.hpp"
+#include "io.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	With --processes auto the size of the simulation pool is taken from the resources this program may use instead of being given:
+	The CPUs are the ones this program may run on (its affinity mask, which is what nproc counts), but no more than the CPU quota of its cgroup (cpu.max in cgroup v2, cpu.cfs_quota_us in v1), since a container usually sees every CPU of its machine but may only use a few of them.
+	The memory is what the kernel reports as available (MemAvailable), but no more than what is left under the memory limit of the cgroup (memory.max in cgroup v2, memory.limit_in_bytes in v1).
+	The pool gets a slot for every CPU, of which AUTO_START_PROCESSES are used at first. Once AUTO_PROBE_JOBS jobs have finished, the largest peak memory of a simulation so far decides how many simulations fit into AUTO_MEMORY_SHARE of the memory, and after every job the number of slots in use is grown or shrunk to that number, but never beyond the number of CPUs.
+	The peak memory of a single simulation is taken from wait4() when it exits, and that of a persistent worker from its VmHWM after every job. Plugin threads share the memory of this program, so with a plugin every slot is used from the start.
+	With --dims-per-job auto the time of every job is modeled as a startup cost plus a cost per parameter set, which are fitted (by least squares) to the jobs that have finished. Once CHUNK_PROBE_JOBS jobs have been measured, enough dimensions are packed into a job that starting the simulation takes at most CHUNK_STARTUP_SHARE of its time, but no more than leave a job for every slot.
+*/
+
+/*	Returns the number of CPUs this program may use.
+*/
+int usable_cpus () {
+	int cpus = sysconf(_SC_NPROCESSORS_ONLN);
+	cpu_set_t mask;
+	CPU_ZERO(&mask);
+	if(sched_getaffinity(0, sizeof(mask), &mask) == 0){
+		cpus = CPU_COUNT(&mask);
+	}
+	char line[128];
+	long long quota = -1;
+	long long period = 0;
+	if(cgroup_file("", "cpu.max", line, sizeof(line))){
+		//A cgroup without a quota has "max" instead of a number.
+		if(sscanf(line, "%lld %lld", &quota, &period) != 2){
+			quota = -1;
+		}
+	} else if(cgroup_file("cpu", "cpu.cfs_quota_us", line, sizeof(line))){
+		quota = atoll(line);
+		if(cgroup_file("cpu", "cpu.cfs_period_us", line, sizeof(line))){
+			period = atoll(line);
+		}
+	}
+	//A quota of one and a half CPUs keeps two simulations busy.
+	if(quota > 0 && period > 0){
+		int allowed = (int)((quota + period - 1) / period);
+		cpus = min(cpus, allowed);
+	}
+	return (cpus < 1 ? 1 : cpus);
+}
+
+/*	Returns the memory that is available to new simulations right now, in kB, or -1 if it is not known.
+*/
+long long memory_available () {
+	long long available = meminfo_value("MemAvailable:");
+	char line[128];
+	long long limit = -1;
+	long long usage = -1;
+	if(cgroup_file("", "memory.max", line, sizeof(line))){
+		//A cgroup without a limit has "max" instead of a number.
+		if(strncmp(line, "max", 3) != 0){
+			limit = atoll(line);
+		}
+		if(cgroup_file("", "memory.current", line, sizeof(line))){
+			usage = atoll(line);
+		}
+	} else if(cgroup_file("memory", "memory.limit_in_bytes", line, sizeof(line))){
+		limit = atoll(line);
+		if(cgroup_file("memory", "memory.usage_in_bytes", line, sizeof(line))){
+			usage = atoll(line);
+		}
+	}
+	//A cgroup v1 without a limit reports the largest multiple of the page size instead.
+	if(limit > 0 && limit < (1LL << 60) && usage >= 0){
+		long long left = (limit > usage ? (limit - usage) / 1024 : 0);
+		if(available < 0 || left < available){
+			available = left;
+		}
+	}
+	return available;
+}
+
+/*	Reads the first line of the file name in the cgroup of this program for controller into buffer (size chars), where an empty controller means the unified hierarchy of cgroup v2.
+	The cgroup is looked up in /proc/self/cgroup. In a container the cgroup is usually the root of the hierarchy that is mounted, so the root is tried as well.
+	Returns false if there is no such file.
+*/
+bool cgroup_file (const char* controller, const char* name, char* buffer, int size) {
+	char group[512] = "";
+	FILE* cgroups = fopen("/proc/self/cgroup", "r");
+	if(cgroups != NULL){
+		//Every line looks like "4:cpu,cpuacct:/batch/job", or "0::/batch/job" for cgroup v2.
+		char line[512];
+		while(fgets(line, sizeof(line), cgroups) != NULL){
+			char* controllers = strchr(line, ':');
+			char* path = (controllers != NULL ? strchr(controllers + 1, ':') : NULL);
+			if(path == NULL) continue;
+			controllers++;
+			*path = '\0';
+			path++;
+			path[strcspn(path, "\n")] = '\0';
+			bool found = (controller[0] == '\0' && controllers[0] == '\0');
+			char* saved = NULL;
+			for(char* token = strtok_r(controllers, ",", &saved); token != NULL && !found && controller[0] != '\0'; token = strtok_r(NULL, ",", &saved)){
+				found = (strcmp(token, controller) == 0);
+			}
+			if(found){
+				snprintf(group, sizeof(group), "%s", (strcmp(path, "/") == 0 ? "" : path));
+				break;
+			}
+		}
+		fclose(cgroups);
+	}
+	char file_name[1024];
+	const char* separator = (controller[0] == '\0' ? "" : "/");
+	snprintf(file_name, sizeof(file_name), "/sys/fs/cgroup%s%s%s/%s", separator, controller, group, name);
+	if(read_line(file_name, buffer, size)){
+		return true;
+	}
+	snprintf(file_name, sizeof(file_name), "/sys/fs/cgroup%s%s/%s", separator, controller, name);
+	return read_line(file_name, buffer, size);
+}
+
+//Reads the first line of the file with the given name into buffer (size chars), without the newline. Returns false if the file could not be read.
+bool read_line (const char* file_name, char* buffer, int size) {
+	FILE* file = fopen(file_name, "r");
+	if(file == NULL){
+		return false;
+	}
+	bool read = (fgets(buffer, size, file) != NULL);
+	fclose(file);
+	if(read){
+		buffer[strcspn(buffer, "\n")] = '\0';
+	}
+	return read;
+}
+
+//Returns the value of the line of /proc/meminfo that starts with key (e.g. "MemAvailable:"), in kB, or -1 if there is no such line.
+long long meminfo_value (const char* key) {
+	FILE* meminfo = fopen("/proc/meminfo", "r");
+	if(meminfo == NULL){
+		return -1;
+	}
+	long long value = -1;
+	char line[256];
+	size_t length = strlen(key);
+	while(fgets(line, sizeof(line), meminfo) != NULL){
+		if(strncmp(line, key, length) == 0){
+			value = atoll(line + length);
+			break;
+		}
+	}
+	fclose(meminfo);
+	return value;
+}
+
+/*	Returns how many slots of the pool are used at first: every slot unless the size of the pool is automatic and the memory of the simulations still has to be measured.
+*/
+int first_limit (input_params& ip) {
+	if(!ip.auto_processes || ip.plugin){
+		return ip.processes;
+	}
+	return min(ip.processes, AUTO_START_PROCESSES);
+}
+
+/*	Called once the job on slot i has finished (and the slot is idle again): adds the simulation's peak memory to what has been measured and, with --processes auto, changes the number of slots in use to the number of simulations that fit into the memory that is available, but at most one per CPU.
+*/
+void resize_pool (input_params& ip, int i) {
+	sim_pool& pool = *ip.pool;
+	if(!pool.auto_size){
+		return;
+	}
+	if(pool.slot[i].peak_rss > pool.max_rss){
+		pool.max_rss = pool.slot[i].peak_rss;
+	}
+	pool.measured++;
+	if(pool.measured < AUTO_PROBE_JOBS){
+		return;
+	}
+	int limit = pool.count;
+	long long budget = memory_available();
+	if(pool.max_rss > 0 && budget >= 0){
+		//The running simulations already use memory that is not available, which is at most their peak each.
+		int busy = 0;
+		for(int j = 0; j < pool.count; j++){
+			busy += (pool.slot[j].job != SLOT_IDLE);
+		}
+		budget = (long long)((budget + (long long)busy * pool.max_rss) * AUTO_MEMORY_SHARE);
+		long long fits = budget / pool.max_rss;
+		limit = (int)(fits < 1 ? 1 : (fits < pool.count ? fits : pool.count));
+	}
+	if(limit == pool.limit){
+		return;
+	}
+	cout << "Simulation processes: " << limit << " of " << pool.count << " (" << pool.max_rss / 1024 << " MB peak memory per simulation, " << (budget >= 0 ? budget / 1024 : 0) << " MB available)\n";
+	pool.limit = limit;
+	//Persistent workers are only started once their slots are used.
+	for(; pool.persistent && !pool.remote && pool.started < pool.limit && ip.failure == NULL; pool.started++){
+		start_worker(ip, pool.started);
+	}
+}
+
+/*	Returns the peak resident memory of the running process pid so far, in kB, or 0 if it is not known.
+*/
+long worker_peak_rss (pid_t pid) {
+	char file_name[64];
+	sprintf(file_name, "/proc/%d/status", (int)pid);
+	FILE* status = fopen(file_name, "r");
+	if(status == NULL){
+		return 0;
+	}
+	long peak = 0;
+	char line[256];
+	while(fgets(line, sizeof(line), status) != NULL){
+		if(strncmp(line, "VmHWM:", 6) == 0){
+			peak = atol(line + 6);
+			break;
+		}
+	}
+	fclose(status);
+	return peak;
+}
+
+/*	Called once the job on slot has finished: with --dims-per-job auto, adds how long it took for how many sets to the sums that the cost of a job is fitted from.
+*/
+void record_job_cost (input_params& ip, sim_slot& slot) {
+	if(!ip.auto_dims_per_job || ip.failure != NULL){
+		return;
+	}
+	sim_pool& pool = *ip.pool;
+	double elapsed = now_seconds() - slot.started;
+	pool.fit_jobs++;
+	pool.fit_sets += slot.sets;
+	pool.fit_time += elapsed;
+	pool.fit_sets_sq += (double)slot.sets * slot.sets;
+	pool.fit_sets_time += slot.sets * elapsed;
+}
+
+/*	Returns how many dimensions of run that have not been started yet are packed into the next job with --dims-per-job auto.
+	Until the startup cost can be told apart from the cost per set, i.e. while every measured job had the same number of sets, jobs of two dimensions are started to measure it.
+*/
+int auto_span (input_params& ip, nominal_run& run) {
+	sim_pool& pool = *ip.pool;
+	if(pool.fit_jobs < CHUNK_PROBE_JOBS){
+		return 1;
+	}
+	double n = pool.fit_jobs;
+	double spread = n * pool.fit_sets_sq - pool.fit_sets * pool.fit_sets;
+	if(spread <= 1e-9 * n * pool.fit_sets_sq){
+		return 2;
+	}
+	double per_set = (n * pool.fit_sets_time - pool.fit_sets * pool.fit_time) / spread;
+	double startup = (pool.fit_time - per_set * pool.fit_sets) / n;
+	int most = (run.ss->jobs >= 2 * pool.count ? run.ss->jobs / pool.count : 1);
+	int span = most;
+	if(per_set > 0 && startup > 0){
+		span = (int)fmin(ceil(startup / (CHUNK_STARTUP_SHARE * per_set * run.ss->sets_per_dim)), most);
+	} else if(startup <= 0){
+		span = 1;
+	}
+	if(span < 1){
+		span = 1;
+	}
+	if(span != pool.span){
+		cout << "Dimensions per job: " << span << " (" << fmax(startup, 0) << " s to start a simulation, " << fmax(per_set, 0) << " s per parameter set)\n";
+		pool.span = span;
+	}
+	return span;
+}
@@ -0,0 +1,48 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+resources.hpp contains function declarations for resources.cpp.
+*/
+
+#ifndef RESOURCES_HPP
+#define RESOURCES_HPP
+
+#include <sched.h>			//(The CPUs this program may run on.)
+#include <sys/resource.h>	//(The peak memory of simulations that have exited.)
+
+#include "init.hpp"
+#include "io.hpp"
+
+//Resource limit functions:
+int usable_cpus();
+long long memory_available();
+bool cgroup_file(const char* , const char* , char* , int );
+bool read_line(const char* , char* , int );
+long long meminfo_value(const char* );
+
+//Pool sizing functions:
+int first_limit(input_params& );
+void resize_pool(input_params& , int );
+long worker_peak_rss(pid_t );
+
+//Job size functions:
+void record_job_cost(input_params& , sim_slot& );
+int auto_span(input_params& , nominal_run& );
+
+#endif
@@ -0,0 +1,264 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+schedule.cpp contains the scheduler that runs the simulations and the analysis of every nominal set.
+*/
+
+#include "schedule.hpp" // Function declarations
+
+#include "analysis.hpp"
+#include "cache.hpp"
+#include "deadline.hpp"
+#include "io.hpp"
+#include "journal.hpp"
+#include "morris.hpp"
+#include "remote.hpp"
+#include "resources.hpp"
+#include "stats.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	This function runs the whole sensitivity analysis for ip.num_nominal nominal sets through one scheduler.
+	Every simulation job of every nominal set (the nominal set itself and the perturbed sets of each dimension) is a task for the simulation pool, and the analysis of a nominal set is a task that becomes ready once all of its simulations have finished.
+	The next nominal set is read as soon as every job of the newest set has been started, so its simulations fill the slots that the stragglers of the previous set leave idle. Up to MAX_SETS_IN_FLIGHT sets are in flight at once, and jobs of older sets are always started first so that they finish as early as possible.
+	The results of every job are read in as soon as it finishes, and a set is analyzed and written out in this process while the simulations of the sets after it keep running.
+	With --tolerance a dimension is simulated one ring at a time, and after each ring dim_converged() (see analysis.cpp) decides whether it needs another one. Further rings are started before the dimensions that have not been started yet.
+	With --screen or --screen-top every dimension is first simulated with only its closest ring, and once all of them are in, screen_dims() (see analysis.cpp) gives the rest of the rings to the dimensions that matter before the set is analyzed.
+	With --cache-dir every job first takes the results it can from the cache (see plan_job() in io.cpp), and the results of the sets it simulated are added to the cache once they are collected.
+	With --deadline the jobs that take too long are copied or killed (see deadline.cpp) before any new job is started.
+	With --dims-per-job or --sets-per-job one simulation can run several dimensions, or part of one (see next_sim_job()), and a dimension is only finished once all of its sets are in.
+*/
+void run_schedule (input_params& ip) {
+	nominal_run* runs[MAX_SETS_IN_FLIGHT];
+	int active = 0;
+	int which_nominal = 0;
+	//Recycled data does not need to be simulated, so no simulation processes are needed.
+	if(!ip.recycle && !start_pool(ip)){
+		return;
+	}
+	while(true){
+		check_deadlines(ip);
+		//Start jobs on every idle slot, reading in the next nominal set whenever the newest one has no jobs left to start.
+		while(ip.failure == NULL){
+			//Jobs whose remote worker was lost go first, since their sets are waiting for them.
+			if(ip.pool != NULL && ip.pool->retry_count > 0){
+				sim_job retry;
+				if(idle_slot(ip) == -1 || !next_retry(ip, &retry)) break;
+				simulate_job(ip, retry);
+				continue;
+			}
+			if(which_nominal < ip.num_nominal && active < MAX_SETS_IN_FLIGHT && (active == 0 || runs[active - 1]->dispatched())){
+				runs[active] = admit_set(ip, which_nominal);
+				if(ip.failure != NULL) break;
+				which_nominal++;
+				//Sets that the run this one resumes has finished are not admitted.
+				if(runs[active] != NULL) active++;
+				continue;
+			}
+			nominal_run* run = next_run(runs, active);
+			if(run == NULL || idle_slot(ip) == -1) break;
+			sim_job job;
+			if(next_sim_job(ip, *run, job)){
+				simulate_job(ip, job);
+			}
+		}
+		
+		//Analyze every set whose simulations have all finished.
+		for(int i = 0; i < active && ip.failure == NULL; i++){
+			if(runs[i]->unfinished > 0) continue;
+			if((ip.screen > 0 || ip.screen_top > 0) && !runs[i]->screened && screen_dims(ip, *runs[i]) > 0) continue;
+			finish_set(ip, *runs[i]);
+			write_set_stats(ip, *runs[i]);
+			delete runs[i];
+			for(int j = i + 1; j < active; j++){
+				runs[j - 1] = runs[j];
+			}
+			active--;
+			i--;
+		}
+		
+		//Wait for the next job to finish and collect its results, unless the features files are all that is wanted.
+		sim_job done;
+		if(ip.pool != NULL && wait_job(ip, &done)){
+			bool collected = !ip.generate_only && ip.failure == NULL && collect_job(ip, done);
+			close_memory_file(done);
+			for(int dim = done.dim; dim < done.dim + done.span; dim++){
+				if(--done.run->pieces[dim + 1] > 0) continue;
+				//A piece of a split dimension was killed at its deadline. See kill_job() in deadline.cpp.
+				if(done.run->failed[dim + 1]){
+					done.run->unfinished--;
+					continue;
+				}
+				if(collected){
+					if(ip.cache_dir != NULL) cache_job(ip, *done.run, dim);
+					journal_job_done(ip, *done.run, dim);
+				}
+				finish_job(ip, *done.run, dim);
+			}
+		} else if(ip.failure != NULL || (active == 0 && which_nominal >= ip.num_nominal)){
+			break;
+		}
+	}
+	//Only sets that could not be finished because of a failure are left.
+	for(int i = 0; i < active; i++){
+		delete runs[i];
+	}
+}
+
+/*	Takes the next job of run that has to be simulated and stores it in job. Returns false if run has no job left to start for now.
+	A job is normally one dimension (or the nominal set), but with --dims-per-job the dimensions that have not been started yet are packed into jobs of up to dims_per_job dimensions (see auto_span() in resources.cpp for --dims-per-job auto), so that a fast simulation does not spend most of its time starting up. Further rings of adaptive dimensions are never packed.
+	With --sets-per-job a dimension with more sets than that is split into pieces of about the same size, which are started one after another and run on different simulations.
+	Jobs whose results are all in the cache are finished without being started, and so are the jobs of a set whose nominal job was killed.
+*/
+bool next_sim_job (input_params& ip, nominal_run& run, sim_job& job) {
+	if(run.split_next < run.split_count){
+		//The next piece of the split dimension, where piece p runs the sets from p*sets/count on.
+		int dim = run.split_dim;
+		int sets = job_sets(run, dim);
+		job = whole_job(run, dim);
+		job.first = run.split_next * sets / run.split_count;
+		job.sets = (run.split_next + 1) * sets / run.split_count - job.first;
+		run.split_next++;
+		return true;
+	}
+	while(!run.dispatched()){
+		int dim = run.take_job();
+		if(run.failed[0] || plan_job(ip, run, dim) == 0){
+			finish_job(ip, run, dim);
+			continue;
+		}
+		job = whole_job(run, dim);
+		run.pieces[dim + 1] = 1;
+		if(dim == JOB_NOMINAL){
+			return true;
+		}
+		if(ip.sets_per_job > 0 && job.sets > ip.sets_per_job){
+			run.split_dim = dim;
+			run.split_count = (job.sets + ip.sets_per_job - 1) / ip.sets_per_job;
+			run.split_next = 0;
+			run.pieces[dim + 1] = run.split_count;
+			return next_sim_job(ip, run, job);
+		}
+		//Only a dimension that was just started is packed with the ones that follow it.
+		int limit = (ip.auto_dims_per_job ? auto_span(ip, run) : ip.dims_per_job);
+		while(job.span < limit && run.refine_count == 0 && run.next_job == job.dim + job.span && run.next_job < run.ss->jobs){
+			int next = run.take_job();
+			if(plan_job(ip, run, next) == 0){
+				finish_job(ip, run, next);
+				break;
+			}
+			run.pieces[next + 1] = 1;
+			job.span++;
+			job.sets += job_sets(run, next);
+		}
+		return true;
+	}
+	return false;
+}
+
+/*	Finishes job dim of run once its results are in, unless it is a ring of a dimension whose sensitivity has not converged yet with --tolerance (see dim_converged() in analysis.cpp), in which case the dimension gets another ring.
+*/
+void finish_job (input_params& ip, nominal_run& run, int dim) {
+	share_output(run, dim);
+	if(ip.tolerance > 0 && dim != JOB_NOMINAL && !run.constant[dim] && !run.failed[0] && ip.failure == NULL && !dim_converged(ip, run, dim)){
+		run.add_rings(dim, run.rings[dim] + 1);
+	} else{
+		run.unfinished--;
+	}
+}
+
+/*	Reads in the next nominal set and makes the nominal_run for it. which_nominal counts the sets that have been read so far.
+	Returns NULL (with ip.failure set) if the set could not be read, or NULL (without it) if the set was finished by the run that is resumed.
+*/
+nominal_run* admit_set (input_params& ip, int which_nominal) {
+	//Read in the nominal parameter set from file.
+	read_nominal(ip);
+	//If ip.nominal is set to NULL after the read_nominal() call, this fails the run.
+	if(ip.nominal == NULL){
+		ip.failure = copy_str("Could not read nominal parameter set.");
+		ip.failcode = which_nominal;
+		return NULL;
+	}
+	if(ip.resume && set_done(ip, ip.set_skip - 1)){
+		cout << "\n ~ Set: " << ip.set_skip - 1 << " -- Finished before ~ \n";
+		return NULL;
+	}
+	//Initializes the struct that holds sets that will be simulated and fills it in with the appropriate values.
+	nominal_run* run = new nominal_run(ip);
+	if(ip.method == METHOD_MORRIS){
+		make_trajectories(ip, *run);
+	}
+	run->admitted = stat_clock(ip);
+	run->dir = make_name(ip.data_dir, (char*)"set_", run->index);
+	make_dir(run->dir);
+	//Recycle checks to see whether the user indicated that the data has already been generated and, if so, assumes it can read the necessary files. 
+	//The recycle option is prone to failure if commandline arguments are inconsistent with previous runs. (There is a warning about this in the usage help.) 
+	if(ip.recycle){
+		run->next_job = run->ss->jobs;
+		run->unfinished = 0;
+		//The features files only hold the sets that plan_job() chose when they were generated.
+		for(int dim = JOB_NOMINAL; dim < run->ss->jobs && !ip.generate_only && ip.failure == NULL; dim++){
+			if(plan_job(ip, *run, dim) > 0){
+				sim_job job = whole_job(*run, dim);
+				collect_job(ip, job);
+			}
+			share_output(*run, dim);
+		}
+	} else{
+		cout << "\n ~ Set: " << run->index << " -- Generating data ~ \n";
+	}
+	return run;
+}
+
+/*	Returns the oldest of the active nominal sets that still has jobs to start, or NULL if there is none.
+*/
+nominal_run* next_run (nominal_run** runs, int active) {
+	for(int i = 0; i < active; i++){
+		if(!runs[i]->dispatched()){
+			return runs[i];
+		}
+	}
+	return NULL;
+}
+
+/*	Calculates and writes the sensitivity of a nominal set whose simulations have all finished.
+	The generate_only option is useful when you only want the features files based on the perurbed parameters and don't need the sensitivity results.
+*/
+void finish_set (input_params& ip, nominal_run& run) {
+	if(ip.generate_only){
+		return;
+	}
+	if(run.failed[0]){
+		cout << "\n ~ Set: " << run.index << " -- No results, the nominal set was killed at its deadline ~ \n";
+		return;
+	}
+	//The LSA_all_dims() function takes care of performing the analysis on the results collected from the simulations, and morris_all_dims() of the screening with --method morris.
+	cout << "\n ~ Set: " << run.index << " -- Calculating sensitivity ~ \n"; 
+	if(ip.method == METHOD_MORRIS){
+		morris_all_dims(ip, run);
+	} else{
+		LSA_all_dims(ip, run);
+	}
+	journal_set_done(ip, run);
+	//collect_job() deletes the features files if ip.delete_data is true, which leaves the set's directory empty.
+	if(ip.delete_data){
+		unmake_dir(run.dir);
+	}
+}
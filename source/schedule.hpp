@@ -0,0 +1,37 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+schedule.hpp contains function declarations for schedule.cpp.
+*/
+
+#ifndef SCHEDULE_HPP
+#define SCHEDULE_HPP
+
+#include "init.hpp"
+#include "io.hpp"
+
+void run_schedule(input_params& );
+bool next_sim_job(input_params& , nominal_run& , sim_job& );
+void finish_job(input_params& , nominal_run& , int );
+nominal_run* admit_set(input_params& , int );
+nominal_run* next_run(nominal_run** , int );
+void finish_set(input_params& , nominal_run& );
+
+#endif
+
@@ -0,0 +1,55 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+simulation-plugin.h declares the C interface of simulation plugins, which are shared libraries that sensitivity loads with dlopen() when --exec names a file ending in ".so". See plugin.cpp.
+This header is plain C so that plugins can be written in C or any language that can export C functions.
+*/
+
+#ifndef SIMULATION_PLUGIN_H
+#define SIMULATION_PLUGIN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*	Optional. Called once, before any simulation, with the arguments given with --sim-args (argv[0] is the path of the plugin) and the random seed.
+	Returns 0 on success, anything else makes sensitivity fail with that value as the error code.
+*/
+int sensitivity_init(int argc, char** argv, int seed);
+
+/*	Required. Simulates sets parameter sets of dims parameters each. params holds the sets one after another, so set s starts at params[s * dims].
+	The output features of set s go to features[s * max_features] onwards, and names[j] should point to the name of feature j, which must stay valid until the plugin is unloaded. The names start out NULL, and a name left NULL is empty.
+	Returns the number of features (at most max_features), or a negative number if the sets could not be simulated.
+	It is called from several threads at once (one per --processes), so it must not change any state that is shared between calls without locking it.
+*/
+int sensitivity_simulate(int dims, int sets, const double* params, int max_features, double* features, const char** names);
+
+/*	Optional. Called once after the last simulation, before the plugin is unloaded.
+*/
+void sensitivity_finish(void);
+
+typedef int (*sensitivity_init_fn)(int , char** , int );
+typedef int (*sensitivity_simulate_fn)(int , int , const double* , int , double* , const char** );
+typedef void (*sensitivity_finish_fn)(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,170 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+stats.cpp contains the timing of the phases of a run and the statistics report (--stats).
+*/
+
+#include "stats.hpp" // Function declarations
+
+#include "deadline.hpp"
+#include "io.hpp"
+#include "resources.hpp"
+#include "macros.hpp"
+
+using namespace std;
+
+/*	With --stats the time spent in every phase of the run is measured with the monotonic clock and written to a JSON report, once for every nominal set when it is finished and once for the whole run at the end:
+		spawn: forking the simulations, or starting the persistent workers.
+		send: writing the parameter sets to the simulations (write_job_sets()), or handing them to the plugin threads.
+		wait: waiting for the simulations to finish (wait_job()). Every wait is counted for the nominal set whose job finished, since the simulations of several sets run at once, and waits that end without a finished job only for the whole run.
+		parse: reading the results of the jobs, from the features files (load_output()) or from the binary results.
+		differentiate: the finite differences of every dimension (fin_dif_one_dim()).
+		normalize: normalizing the sensitivities.
+		write: writing the results files.
+	The report of the run also has the number of jobs and parameter sets that were simulated per second, and the core utilization: the CPU time of this program and of its simulations divided by the CPU time the usable CPUs had during the run. The CPU time of persistent workers is only known once they have exited, and that of remote workers is not known at all.
+	Without --stats the clock is never read.
+*/
+
+//The names of the phases in the report, in the order of the STAT macros.
+static const char* phase_names[STAT_PHASES] = {"spawn", "send", "wait", "parse", "differentiate", "normalize", "write"};
+
+/*	Starts the report if --stats was given. The run fails (with ip.failure set) if the report cannot be written.
+*/
+void open_stats (input_params& ip) {
+	if(ip.stats_file == NULL){
+		return;
+	}
+	ip.stats = new run_stats();
+	ip.stats->file.open(ip.stats_file);
+	if(!ip.stats->file){
+		delete ip.stats;
+		ip.stats = NULL;
+		const char* fail_prefix = "!!! Failure: could not open the statistics file ";
+		ip.failure = (char*)mallocate(sizeof(char)*(strlen(fail_prefix) + strlen(ip.stats_file) + 4 + 1));
+		sprintf(ip.failure, "%s%s !!!", fail_prefix, ip.stats_file);
+		return;
+	}
+	ip.stats->started = now_seconds();
+	ip.stats->cpu = cpu_seconds(RUSAGE_SELF);
+	ip.stats->children_cpu = cpu_seconds(RUSAGE_CHILDREN);
+	ip.stats->file.precision(6);
+	ip.stats->file << fixed << "{\n\t\"sets\": [";
+}
+
+/*	Finishes the report with the statistics of the whole run. Called once the simulation pool has been stopped, so that the CPU time of every simulation is counted.
+*/
+void close_stats (input_params& ip) {
+	if(ip.stats == NULL){
+		return;
+	}
+	run_stats& stats = *ip.stats;
+	double wall = now_seconds() - stats.started;
+	double self_cpu = cpu_seconds(RUSAGE_SELF) - stats.cpu;
+	double children_cpu = cpu_seconds(RUSAGE_CHILDREN) - stats.children_cpu;
+	int cpus = usable_cpus();
+	ofstream& out = stats.file;
+	out << (stats.num_sets > 0 ? "\n\t],\n" : "],\n");
+	out << "\t\"run\": {\n";
+	out << "\t\t\"wall_seconds\": " << wall << ",\n";
+	out << "\t\t\"nominal_sets\": " << stats.num_sets << ",\n";
+	out << "\t\t\"jobs\": " << stats.jobs << ",\n";
+	out << "\t\t\"simulated_sets\": " << stats.sets << ",\n";
+	out << "\t\t\"processes\": " << ip.processes << ",\n";
+	out << "\t\t\"usable_cpus\": " << cpus << ",\n";
+	write_phases(out, stats.times, "\t\t");
+	out << "\t\t\"jobs_per_second\": " << (wall > 0 ? stats.jobs / wall : 0) << ",\n";
+	out << "\t\t\"simulations_per_second\": " << (wall > 0 ? stats.sets / wall : 0) << ",\n";
+	out << "\t\t\"cpu_seconds\": " << self_cpu << ",\n";
+	out << "\t\t\"simulation_cpu_seconds\": " << children_cpu << ",\n";
+	out << "\t\t\"core_utilization\": " << (wall > 0 ? (self_cpu + children_cpu) / (wall * cpus) : 0) << ",\n";
+	out << "\t\t\"failed\": " << (ip.failure != NULL ? "true" : "false") << "\n";
+	out << "\t}\n}\n";
+	out.close();
+	delete ip.stats;
+	ip.stats = NULL;
+}
+
+/*	Adds the statistics of the nominal set run, which has just been finished, to the report.
+*/
+void write_set_stats (input_params& ip, nominal_run& run) {
+	if(ip.stats == NULL){
+		return;
+	}
+	run_stats& stats = *ip.stats;
+	ofstream& out = stats.file;
+	out << (stats.num_sets > 0 ? "," : "") << "\n\t\t{\n";
+	out << "\t\t\t\"set\": " << run.index << ",\n";
+	out << "\t\t\t\"wall_seconds\": " << now_seconds() - run.admitted << ",\n";
+	out << "\t\t\t\"jobs\": " << run.jobs_done << ",\n";
+	out << "\t\t\t\"simulated_sets\": " << run.sets_done << ",\n";
+	write_phases(out, run.times, "\t\t\t");
+	out << "\t\t\t\"failed\": " << (run.failed[0] ? "true" : "false") << "\n";
+	out << "\t\t}";
+	out.flush();
+	stats.num_sets++;
+}
+
+//Writes the time of every phase in times as a "phase_seconds" object, with each line indented by indent.
+void write_phases (ofstream& out, double* times, const char* indent) {
+	out << indent << "\"phase_seconds\": {";
+	for(int i = 0; i < STAT_PHASES; i++){
+		out << (i > 0 ? ", " : "") << '"' << phase_names[i] << "\": " << times[i];
+	}
+	out << "},\n";
+}
+
+/*	Returns the time to measure a phase from, or 0 without --stats.
+*/
+double stat_clock (input_params& ip) {
+	return (ip.stats != NULL ? now_seconds() : 0);
+}
+
+//Returns the user and system CPU time of who (RUSAGE_SELF or RUSAGE_CHILDREN) so far, in seconds.
+double cpu_seconds (int who) {
+	struct rusage usage;
+	if(getrusage(who, &usage) == -1){
+		return 0;
+	}
+	return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6 + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+/*	Adds the time since started (see stat_clock()) to the phase of the run and, if run is not NULL, of the nominal set run.
+*/
+void stat_add (input_params& ip, nominal_run* run, int phase, double started) {
+	if(ip.stats == NULL){
+		return;
+	}
+	double spent = now_seconds() - started;
+	ip.stats->times[phase] += spent;
+	if(run != NULL){
+		run->times[phase] += spent;
+	}
+}
+
+/*	Counts a job of run that simulated sets parameter sets and has just finished.
+*/
+void stat_job (input_params& ip, nominal_run& run, int sets) {
+	if(ip.stats == NULL){
+		return;
+	}
+	ip.stats->jobs++;
+	ip.stats->sets += sets;
+	run.jobs_done++;
+	run.sets_done += sets;
+}
@@ -0,0 +1,65 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+stats.hpp contains the struct for the statistics report and function declarations for stats.cpp.
+*/
+
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <sys/resource.h>	//(The CPU time of this program and of its simulations.)
+
+#include "init.hpp"
+
+//Struct for the statistics of a run that are written to ip.stats_file (--stats).
+struct run_stats{
+	ofstream file; //The report, to which every nominal set is added once it is finished.
+	double started; //When the run was started, in seconds (see now_seconds() in deadline.cpp).
+	double cpu; //The CPU time this program had used when the run was started, in seconds.
+	double children_cpu; //The CPU time the children of this program that had exited when the run was started had used, in seconds.
+	double times[STAT_PHASES]; //The time spent in every phase, in seconds.
+	int jobs; //The number of jobs that were simulated.
+	long long sets; //The number of parameter sets that were simulated.
+	int num_sets; //The number of nominal sets in the report so far.
+	run_stats(){
+		started = 0;
+		cpu = 0;
+		children_cpu = 0;
+		for(int i = 0; i < STAT_PHASES; i++){
+			times[i] = 0;
+		}
+		jobs = 0;
+		sets = 0;
+		num_sets = 0;
+	}
+};
+
+//Report functions:
+void open_stats(input_params& );
+void close_stats(input_params& );
+void write_set_stats(input_params& , nominal_run& );
+void write_phases(ofstream& , double* , const char* );
+
+//Timing functions:
+double stat_clock(input_params& );
+double cpu_seconds(int );
+void stat_add(input_params& , nominal_run* , int , double );
+void stat_job(input_params& , nominal_run& , int );
+
+#endif
@@ -0,0 +1,147 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+threads.cpp contains the pool of threads that shares the analysis of a nominal set with the main thread (--analysis-threads).
+*/
+
+#include "threads.hpp" // Function declarations
+
+#include "macros.hpp"
+
+using namespace std;
+
+/*	The work of the analysis is split into items (e.g. the dimensions of a nominal set) that do not depend on each other and each write their own results, so the results are the same whichever thread does an item and in whatever order.
+	run_work() shares the items out in chunks to the threads of ip.workers and the main thread, which takes chunks too, and returns once every item is done. Everything that has to happen in order, like writing to cout, is left to the main thread before or after.
+	The threads are started once and wait between nominal sets, so each set only costs a wake-up.
+*/
+
+/*	Starts the ip.analysis_threads - 1 threads that help the main thread, if there are any.
+	A thread that cannot be started is not fatal: the work is shared among the threads that were.
+*/
+void start_work_pool (input_params& ip) {
+	if(ip.analysis_threads <= 1){
+		return;
+	}
+	work_pool* pool = new work_pool(ip.analysis_threads - 1);
+	ip.workers = pool;
+	for(int i = 0; i < pool->count; i++){
+		if(pthread_create(&pool->threads[i], NULL, work_thread, pool) != 0){
+			break;
+		}
+		pool->started++;
+	}
+}
+
+/*	Stops and joins the threads of ip.workers, which must not have any work left.
+*/
+void stop_work_pool (input_params& ip) {
+	work_pool* pool = ip.workers;
+	if(pool == NULL){
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = true;
+	pthread_cond_broadcast(&pool->wake);
+	pthread_mutex_unlock(&pool->lock);
+	for(int i = 0; i < pool->started; i++){
+		pthread_join(pool->threads[i], NULL);
+	}
+	delete pool;
+	ip.workers = NULL;
+}
+
+/*	The function every thread of a work pool runs: it does chunks of the work whenever there is work, until the pool is stopped.
+*/
+void* work_thread (void* arg) {
+	work_pool& pool = *(work_pool*)arg;
+	//A thread that starts late still takes part in the first work, which has generation 1.
+	int seen = 0;
+	pthread_mutex_lock(&pool.lock);
+	while(true){
+		while(pool.generation == seen && !pool.stopping){
+			pthread_cond_wait(&pool.wake, &pool.lock);
+		}
+		if(pool.stopping){
+			break;
+		}
+		seen = pool.generation;
+		int first = 0;
+		int last = 0;
+		while(take_items(pool, &first, &last)){
+			pthread_mutex_unlock(&pool.lock);
+			pool.work(pool.context, first, last);
+			pthread_mutex_lock(&pool.lock);
+		}
+		pool.busy--;
+		if(pool.busy == 0){
+			pthread_cond_signal(&pool.done);
+		}
+	}
+	pthread_mutex_unlock(&pool.lock);
+	return NULL;
+}
+
+/*	Does items 0 up to count of work with context, sharing them out to the threads of ip.workers. Without a pool, or with too few items to share, the main thread does all of them itself.
+	The items are taken ANALYSIS_CHUNKS chunks per thread at a time, so that a thread that gets slow items does not hold up the others for long.
+*/
+void run_work (input_params& ip, int count, work_fn work, void* context) {
+	work_pool* pool = ip.workers;
+	if(pool == NULL || pool->started == 0 || count < 2){
+		work(context, 0, count);
+		return;
+	}
+	pthread_mutex_lock(&pool->lock);
+	pool->work = work;
+	pool->context = context;
+	pool->next = 0;
+	pool->end = count;
+	pool->chunk = count / ((pool->started + 1) * ANALYSIS_CHUNKS);
+	if(pool->chunk < 1){
+		pool->chunk = 1;
+	}
+	//Every thread is busy until it has seen that there are no items left, even if it gets none, and so is the main thread.
+	pool->busy = pool->started + 1;
+	pool->generation++;
+	pthread_cond_broadcast(&pool->wake);
+	int first = 0;
+	int last = 0;
+	while(take_items(*pool, &first, &last)){
+		pthread_mutex_unlock(&pool->lock);
+		work(context, first, last);
+		pthread_mutex_lock(&pool->lock);
+	}
+	pool->busy--;
+	while(pool->busy > 0){
+		pthread_cond_wait(&pool->done, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/*	Takes the next chunk of the work of pool, whose lock has to be held, and sets first and last to its items.
+	Returns false if every item has been taken.
+*/
+bool take_items (work_pool& pool, int* first, int* last) {
+	if(pool.next >= pool.end){
+		return false;
+	}
+	*first = pool.next;
+	*last = (pool.next + pool.chunk < pool.end ? pool.next + pool.chunk : pool.end);
+	pool.next = *last;
+	return true;
+}
@@ -0,0 +1,79 @@
+/*
+Sensitivity analysis for simulations
+Copyright (C) 2013 Ahmet Ay, Jack Holland, Adriana Sperlea, Sebastian Sangervasi
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or
+(at your option) any later version.
+
+This program is distributed in the hope that it will be useful,
+but WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+GNU General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+/*
+threads.hpp contains the struct for the pool of analysis threads and function declarations for threads.cpp.
+*/
+
+#ifndef THREADS_HPP
+#define THREADS_HPP
+
+#include <pthread.h>	//(The analysis threads.)
+
+#include "init.hpp"
+
+//The function a work pool runs: it does the items from first up to (not including) last of the work described by context.
+typedef void (*work_fn)(void* context, int first, int last);
+
+//Struct for the threads that share the work of the analysis with the main thread (--analysis-threads). Everything but threads and count is guarded by lock.
+struct work_pool{
+	pthread_t* threads;
+	int count; //The number of threads, not counting the main thread.
+	int started; //The number of threads that have been started.
+	pthread_mutex_t lock;
+	pthread_cond_t wake; //Signalled when there is work or the threads have to stop.
+	pthread_cond_t done; //Signalled when the last thread that was doing work has finished its items.
+	work_fn work; //The work that is being shared out.
+	void* context;
+	int next; //The first item that has not been taken yet.
+	int end; //The number of items of the work.
+	int chunk; //The number of items that are taken at a time.
+	int busy; //The number of threads (and the main thread) that have not finished with the current work.
+	int generation; //The number of times work has been shared out, so that every thread takes part in each work exactly once.
+	bool stopping;
+	work_pool(int threads_count){
+		count = threads_count;
+		started = 0;
+		threads = new pthread_t[count];
+		pthread_mutex_init(&lock, NULL);
+		pthread_cond_init(&wake, NULL);
+		pthread_cond_init(&done, NULL);
+		work = NULL;
+		context = NULL;
+		next = 0;
+		end = 0;
+		chunk = 1;
+		busy = 0;
+		generation = 0;
+		stopping = false;
+	}
+	~work_pool(){
+		pthread_mutex_destroy(&lock);
+		pthread_cond_destroy(&wake);
+		pthread_cond_destroy(&done);
+		delete[] threads;
+	}
+};
+
+void start_work_pool(input_params& );
+void stop_work_pool(input_params& );
+void* work_thread(void* );
+void run_work(input_params& , int , work_fn , void* );
+bool take_items(work_pool& , int* , int* );
+
+#endif